@@ -0,0 +1,202 @@
+#include "BeamSearch.h"
+#include "CounterpointEngine.h"  // For NotePair definition
+#include <algorithm>
+
+namespace
+{
+    struct IntervalOption {
+        int semitones;
+        float weight;
+    };
+
+    // Consonances the generator may pick, with their stylistic prior
+    constexpr IntervalOption consonantIntervals[] = {
+        {3, 0.25f},
+        {4, 0.25f},
+        {7, 0.10f},
+        {8, 0.20f},
+        {9, 0.15f},
+        {12, 0.05f}
+    };
+
+    constexpr int numIntervals = (int)(sizeof(consonantIntervals) / sizeof(consonantIntervals[0]));
+    static_assert(numIntervals <= BeamSearch::maxCandidates);
+    static_assert(BeamSearch::maxCandidates <= RuleChecker::maxBatchCandidates);
+    constexpr int minSeparation = 3;
+    constexpr float lookaheadDiscount = 0.8f;
+    constexpr int hypotheticalSteps[] = { 2, -2 };
+}
+
+bool BeamSearch::Run::expired()
+{
+    if (!timedOut && deadlineTicks != 0 && juce::Time::getHighResolutionTicks() >= deadlineTicks)
+        timedOut = true;
+    return timedOut;
+}
+
+int BeamSearch::candidatePitches(int inputPitch, bool above, int* out) const
+{
+    Candidate cands[maxCandidates];
+    int n = collectCandidates(inputPitch, above, cands);
+    for (int i = 0; i < n; ++i)
+        out[i] = cands[i].pitch;
+    return n;
+}
+
+int BeamSearch::collectCandidates(int inputPitch, bool above, Candidate* out) const
+{
+    // Prefer the requested side; only cross over if nothing fits the range there
+    for (int side = 0; side < 2; ++side)
+    {
+        const bool up = (side == 0) ? above : !above;
+        int n = 0;
+
+        for (const auto& option : consonantIntervals)
+        {
+            int pitch = up ? inputPitch + option.semitones : inputPitch - option.semitones;
+            if (pitch < minPitch || pitch > maxPitch)
+                continue;
+            if (std::abs(pitch - inputPitch) <= minSeparation)
+                continue;
+
+            out[n++] = { pitch, option.weight, true };
+        }
+
+        if (n > 0)
+            return n;
+    }
+    return 0;
+}
+
+float BeamSearch::scoreCandidate(const std::vector<NotePair>& path, int inputPitch, int genPitch,
+                                 float ruleScore, float prior) const
+{
+    // path ends with the pair before the candidate
+    float melodic = 0.0f;
+    if (!path.empty())
+    {
+        const NotePair& prev = path.back();
+        int genMove = genPitch - prev.generatedPitch;
+        int inMove = inputPitch - prev.inputPitch;
+        int leap = std::abs(genMove);
+
+        if (genMove * inMove < 0) melodic += 0.15f;         // contrary motion
+        if (leap > 0 && leap <= 2) melodic += 0.1f;         // stepwise line
+        else if (leap == 0) melodic -= 0.05f;               // static line
+        else if (leap > 7) melodic -= 0.2f;                 // large leap
+    }
+
+    return ruleScore + 0.5f * prior + melodic;
+}
+
+int BeamSearch::expand(std::vector<NotePair>& path, int inputPitch, bool above, Candidate* out, Run& run) const
+{
+    int n = collectCandidates(inputPitch, above, out);
+
+    // Rules for all candidates in one pass
+    int pitches[maxCandidates];
+    float ruleScores[maxCandidates];
+    for (int i = 0; i < n; ++i)
+        pitches[i] = out[i].pitch;
+    const CandidateMasks masks = ruleChecker.evaluateBatch(path, inputPitch, { pitches, (size_t)n }, ruleScores);
+
+    for (int i = 0; i < n; ++i)
+    {
+        out[i].legal = ((masks.legal >> i) & 1u) != 0;
+        out[i].score = scoreCandidate(path, inputPitch, out[i].pitch, ruleScores[i], out[i].score);
+        ++run.nodes;
+    }
+
+    std::sort(out, out + n, [](const Candidate& a, const Candidate& b) {
+        if (a.legal != b.legal) return a.legal;
+        return a.score > b.score;
+    });
+    return n;
+}
+
+float BeamSearch::lookahead(std::vector<NotePair>& path, bool above, double nowSec,
+                            int depth, Run& run) const
+{
+    if (depth <= 0 || path.empty() || run.expired())
+        return 0.0f;
+
+    const int lastInput = path.back().inputPitch;
+    float total = 0.0f;
+
+    for (int step : hypotheticalSteps)
+    {
+        const int nextInput = lastInput + step;
+        Candidate cands[maxCandidates];
+        int n = expand(path, nextInput, above, cands, run);
+        int keep = std::min(n, config.beamWidth);
+
+        float best = 0.0f;
+        for (int i = 0; i < keep; ++i)
+        {
+            path.emplace_back(nextInput, cands[i].pitch, nowSec);
+            float value = cands[i].score + lookaheadDiscount * lookahead(path, above, nowSec, depth - 1, run);
+            path.pop_back();
+            best = std::max(best, value);
+        }
+        total += best;
+    }
+
+    return total / (float)std::size(hypotheticalSteps);
+}
+
+SearchResult BeamSearch::search(std::vector<NotePair>& path, int inputPitch, bool above, double nowSec) const
+{
+    SearchLimits limits;
+    limits.depth = config.lookaheadDepth;
+    return search(path, inputPitch, above, nowSec, limits);
+}
+
+SearchResult BeamSearch::search(std::vector<NotePair>& path, int inputPitch, bool above, double nowSec,
+                                const SearchLimits& limits) const
+{
+    SearchResult result;
+    Run run;
+    run.deadlineTicks = limits.deadlineTicks;
+
+    Candidate cands[maxCandidates];
+    int n = expand(path, inputPitch, above, cands, run);
+
+    if (n == 0)
+    {
+        // Input is outside the playable range: clamp to a fifth on the requested side
+        result.pitch = juce::jlimit(minPitch, maxPitch, above ? inputPitch + 7 : inputPitch - 7);
+        result.nodesExpanded = run.nodes;
+        return result;
+    }
+
+    if (limits.pitchBias != nullptr)
+        for (int i = 0; i < n; ++i)
+            cands[i].score += limits.pitchBias[cands[i].pitch];
+
+    const int keep = (limits.depth > 0) ? std::min(n, std::max(1, config.beamWidth)) : n;
+    float bestValue = -1.0f;
+
+    for (int i = 0; i < keep; ++i)
+    {
+        float value = cands[i].score;
+        if (limits.depth > 0)
+        {
+            path.emplace_back(inputPitch, cands[i].pitch, nowSec);
+            value += lookaheadDiscount * lookahead(path, above, nowSec, limits.depth, run);
+            path.pop_back();
+        }
+
+        // Candidates are sorted legal-first, so an illegal one never displaces a legal one
+        if (result.pitch < 0 || (cands[i].legal == result.legal && value > bestValue))
+        {
+            result.pitch = cands[i].pitch;
+            result.legal = cands[i].legal;
+            result.score = cands[i].score;
+            bestValue = value;
+        }
+    }
+
+    result.nodesExpanded = run.nodes;
+    result.complete = !run.timedOut;
+    return result;
+}
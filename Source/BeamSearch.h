@@ -0,0 +1,78 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <vector>
+#include "RuleChecker.h"
+
+// Forward declaration
+struct NotePair;
+
+// Beam width / lookahead used by the generator
+struct SearchConfig
+{
+    int beamWidth = 4;       // candidates kept per level
+    int lookaheadDepth = 2;  // future notes explored after the current one
+};
+
+struct SearchResult
+{
+    int pitch = -1;
+    float score = 0.0f;
+    int nodesExpanded = 0;   // candidate notes scored to reach this result
+    bool legal = false;      // false if every candidate broke a rule
+    bool complete = true;    // false if the deadline cut the search short
+};
+
+// Per-call limits for deadline-bounded ("anytime") generation
+struct SearchLimits
+{
+    int depth = 0;                   // lookahead depth for this call
+    juce::int64 deadlineTicks = 0;   // juce::Time high-resolution ticks; 0 = no deadline
+    const float* pitchBias = nullptr; // optional 128-entry bonus added to first-level candidates
+
+    static constexpr float modelWeight = 0.3f;   // model probability -> pitchBias, wherever the model is blended in
+};
+
+// Deterministic beam search over consonant candidates, scored by RuleChecker.
+// Lookahead assumes the next input moves by a whole step either way and
+// rewards candidates that leave good continuations for both.
+class BeamSearch {
+public:
+    void setConfig(const SearchConfig& c) { config = c; }
+    const SearchConfig& getConfig() const { return config; }
+
+    // path holds the committed history; it is used as scratch and restored before returning.
+    // Only its last historyNeeded pairs are read, so callers need not copy more.
+    SearchResult search(std::vector<NotePair>& path, int inputPitch, bool above, double nowSec) const;
+    SearchResult search(std::vector<NotePair>& path, int inputPitch, bool above, double nowSec,
+                        const SearchLimits& limits) const;
+
+    // Candidate pitches considered for the current note, e.g. for model scoring
+    int candidatePitches(int inputPitch, bool above, int* out) const;
+    static constexpr int maxCandidates = 6;
+    static constexpr int historyNeeded = 1;
+
+    static constexpr int minPitch = 36;
+    static constexpr int maxPitch = 84;
+
+private:
+    struct Candidate { int pitch; float score; bool legal; };
+
+    struct Run
+    {
+        int nodes = 0;
+        juce::int64 deadlineTicks = 0;
+        bool timedOut = false;
+
+        bool expired();
+    };
+
+    int collectCandidates(int inputPitch, bool above, Candidate* out) const;
+    float scoreCandidate(const std::vector<NotePair>& path, int inputPitch, int genPitch,
+                         float ruleScore, float prior) const;
+    float lookahead(std::vector<NotePair>& path, bool above, double nowSec,
+                    int depth, Run& run) const;
+    int expand(std::vector<NotePair>& path, int inputPitch, bool above, Candidate* out, Run& run) const;
+
+    RuleChecker ruleChecker;
+    SearchConfig config;
+};
@@ -0,0 +1,321 @@
+#include "CachingModelBridge.h"
+#include <cmath>
+
+namespace
+{
+    int pitchClass(int p) { return ((p % 12) + 12) % 12; }
+
+    size_t approximateBytes(const CachedScores& s, size_t signatureSize)
+    {
+        size_t bytes = sizeof(CachedScores) + s.probs.size() * sizeof(float)
+                     + (s.influenceNotes.size() + s.influenceStart.size() + signatureSize) * sizeof(int);
+        for (const auto& r : s.rationale)
+            bytes += sizeof(Rationale) + r.influences.size() * sizeof(Influence)
+                   + r.summary.getNumBytesAsUTF8() + r.detail.getNumBytesAsUTF8();
+        return bytes;
+    }
+}
+
+Rationale SharedScores::get(size_t i, std::span<const ContextNote> context) const
+{
+    Rationale r = scores->rationale[i];
+    r.candidatePitch += reference;
+
+    const int first = scores->influenceStart[i];
+    for (size_t j = 0; j < r.influences.size(); ++j)
+    {
+        auto& inf = r.influences[j];
+        inf.pitch += reference;
+
+        const int fromEnd = scores->influenceNotes[(size_t)first + j];
+        if (fromEnd >= 0 && fromEnd < (int)context.size())
+        {
+            const auto& note = context[context.size() - 1 - (size_t)fromEnd];
+            inf.startSec = note.startSec;
+            inf.endSec = note.endSec;
+        }
+    }
+    return r;
+}
+
+//==============================================================================
+CachingModelBridge::CachingModelBridge(std::shared_ptr<ModelBridge> model, int entries, size_t bytes)
+    : inner(std::move(model)), maxEntries(juce::jmax(1, entries)), maxBytes(bytes)
+{
+    index.reserve((size_t)maxEntries);
+}
+
+CachingModelBridge::Query CachingModelBridge::makeQuery(std::span<const ContextNote> context, std::span<const int> candidates,
+                                                        int keyRoot, bool isMajor) const
+{
+    Query q;
+    const size_t window = (size_t)juce::jmax(1, inner->contextWindow());
+    q.context = context.size() > window ? context.last(window) : context;
+    q.candidates = candidates;
+    q.reference = !context.empty() ? context.back().pitch : (!candidates.empty() ? candidates.front() : 0);
+    q.keyClass = pitchClass(keyRoot - q.reference);
+    q.isMajor = isMajor;
+
+    // FNV-1a over the same values signatureOf() stores, one 32-bit value at a time. Every
+    // value is relative to the reference, so this is recomputed in full for each call
+    juce::uint64 h = 1469598103934665603ull;
+    auto mix = [&h](int v) { h = (h ^ (juce::uint64)(juce::uint32)v) * 1099511628211ull; };
+    mix((int)q.context.size());
+    for (const auto& note : q.context)
+        mix(note.pitch - q.reference);
+    mix((int)q.candidates.size());
+    for (int c : q.candidates)
+        mix(c - q.reference);
+    mix(q.keyClass);
+    mix(q.isMajor ? 1 : 0);
+    q.hash = h;
+    return q;
+}
+
+std::vector<int> CachingModelBridge::signatureOf(const Query& q)
+{
+    std::vector<int> sig;
+    sig.reserve(q.context.size() + q.candidates.size() + 4);
+    sig.push_back((int)q.context.size());
+    for (const auto& note : q.context)
+        sig.push_back(note.pitch - q.reference);
+    sig.push_back((int)q.candidates.size());
+    for (int c : q.candidates)
+        sig.push_back(c - q.reference);
+    sig.push_back(q.keyClass);
+    sig.push_back(q.isMajor ? 1 : 0);
+    return sig;
+}
+
+bool CachingModelBridge::matches(const std::vector<int>& sig, const Query& q)
+{
+    if (sig.size() != q.context.size() + q.candidates.size() + 4)
+        return false;
+
+    size_t i = 0;
+    if (sig[i++] != (int)q.context.size())
+        return false;
+    for (const auto& note : q.context)
+        if (sig[i++] != note.pitch - q.reference)
+            return false;
+    if (sig[i++] != (int)q.candidates.size())
+        return false;
+    for (int c : q.candidates)
+        if (sig[i++] != c - q.reference)
+            return false;
+    return sig[i] == q.keyClass && sig[i + 1] == (q.isMajor ? 1 : 0);
+}
+
+std::shared_ptr<const CachedScores> CachingModelBridge::find(const Query& q, bool needRationale)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto [first, last] = index.equal_range(q.hash);
+    for (auto it = first; it != last; ++it)
+    {
+        auto entry = it->second;
+        if (!matches(entry->signature, q))
+            continue;
+        if (needRationale && entry->scores->rationale.empty() && !q.candidates.empty())
+            break;
+
+        lru.splice(lru.begin(), lru, entry);
+        ++hits;
+        return entry->scores;
+    }
+
+    ++misses;
+    return nullptr;
+}
+
+void CachingModelBridge::insert(const Query& q, std::shared_ptr<const CachedScores> scores)
+{
+    auto signature = signatureOf(q);
+    const size_t bytes = approximateBytes(*scores, signature.size());
+
+    const juce::ScopedLock sl(lock);
+
+    // Replace a probability-only entry, or one another thread just added
+    auto [first, last] = index.equal_range(q.hash);
+    for (auto it = first; it != last; ++it)
+    {
+        auto entry = it->second;
+        if (matches(entry->signature, q))
+        {
+            totalBytes = totalBytes - entry->bytes + bytes;
+            entry->scores = std::move(scores);
+            entry->bytes = bytes;
+            lru.splice(lru.begin(), lru, entry);
+            while (totalBytes > maxBytes && lru.size() > 1)
+                evictOldest();
+            return;
+        }
+    }
+
+    // A result bigger than the whole budget is not worth emptying the cache for
+    if (bytes > maxBytes)
+        return;
+
+    while ((int)lru.size() >= maxEntries || totalBytes + bytes > maxBytes)
+        evictOldest();
+
+    lru.push_front({ q.hash, std::move(signature), std::move(scores), bytes });
+    index.emplace(q.hash, lru.begin());
+    totalBytes += bytes;
+}
+
+void CachingModelBridge::evictOldest()
+{
+    auto& oldest = lru.back();
+    auto [first, last] = index.equal_range(oldest.hash);
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second == std::prev(lru.end()))
+        {
+            index.erase(it);
+            break;
+        }
+    }
+    totalBytes -= oldest.bytes;
+    lru.pop_back();
+    ++evictions;
+}
+
+SharedScores CachingModelBridge::scoreShared(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                             int keyRoot, bool isMajor)
+{
+    const Query q = makeQuery(context, candidatePitches, keyRoot, isMajor);
+    if (auto cached = find(q, true))
+        return { std::move(cached), q.reference };
+
+    auto rationale = inner->scoreCandidates({ context.begin(), context.end() },
+                                            { candidatePitches.begin(), candidatePitches.end() }, keyRoot, isMajor);
+
+    // Store relative to the reference pitch, with influences tied to context positions
+    auto scores = std::make_shared<CachedScores>();
+    scores->probs.reserve(rationale.size());
+    scores->influenceStart.reserve(rationale.size() + 1);
+    for (auto& r : rationale)
+    {
+        scores->probs.push_back(r.prob);
+        scores->influenceStart.push_back((int)scores->influenceNotes.size());
+        r.candidatePitch -= q.reference;
+
+        for (auto& inf : r.influences)
+        {
+            int fromEnd = -1;
+            for (size_t k = 0; k < context.size(); ++k)
+            {
+                const auto& note = context[context.size() - 1 - k];
+                if (note.pitch == inf.pitch && std::abs(note.startSec - inf.startSec) < 1.0e-6)
+                {
+                    fromEnd = (int)k;
+                    break;
+                }
+            }
+            scores->influenceNotes.push_back(fromEnd);
+            inf.pitch -= q.reference;
+        }
+    }
+    scores->influenceStart.push_back((int)scores->influenceNotes.size());
+    scores->rationale = std::move(rationale);
+
+    SharedScores result { scores, q.reference };
+    insert(q, std::move(scores));
+    return result;
+}
+
+std::vector<Rationale> CachingModelBridge::scoreCandidates(const std::vector<ContextNote>& context,
+                                                           const std::vector<int>& candidatePitches,
+                                                           int keyRoot, bool isMajor)
+{
+    // The interface returns owned copies; callers that can share use scoreShared
+    const auto shared = scoreShared(context, candidatePitches, keyRoot, isMajor);
+    std::vector<Rationale> out;
+    out.reserve(shared.size());
+    for (size_t i = 0; i < shared.size(); ++i)
+        out.push_back(shared.get(i, context));
+    return out;
+}
+
+void CachingModelBridge::scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                            int keyRoot, bool isMajor, std::span<float> probsOut)
+{
+    const Query q = makeQuery(context, candidatePitches, keyRoot, isMajor);
+    if (auto cached = find(q, false))
+    {
+        std::copy(cached->probs.begin(), cached->probs.end(), probsOut.begin());
+        return;
+    }
+
+    inner->scoreProbabilities(context, candidatePitches, keyRoot, isMajor, probsOut);
+
+    auto scores = std::make_shared<CachedScores>();
+    scores->probs.assign(probsOut.begin(), probsOut.begin() + (std::ptrdiff_t)candidatePitches.size());
+    insert(q, std::move(scores));
+}
+
+void CachingModelBridge::scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                                    std::span<float> probsOut)
+{
+    std::vector<ContextNote> scratch((size_t)juce::jmax(1, inner->contextWindow()) + 1);
+    std::vector<ScoreRequest> missed;
+    std::vector<size_t> missedOffsets;
+
+    size_t offset = 0;
+    for (const auto& req : requests)
+    {
+        const size_t n = req.candidatePitches.size();
+        jassert(offset + n <= probsOut.size());
+        const Query q = makeQuery(req.resolvedContext(scratch), req.candidatePitches, keyRoot, isMajor);
+        if (auto cached = find(q, false))
+        {
+            std::copy(cached->probs.begin(), cached->probs.end(), probsOut.begin() + (std::ptrdiff_t)offset);
+        }
+        else
+        {
+            missed.push_back(req);
+            missedOffsets.push_back(offset);
+        }
+        offset += n;
+    }
+
+    if (missed.empty())
+        return;
+
+    std::vector<float> missedProbs(totalCandidates(missed));
+    inner->scoreBatch(missed, keyRoot, isMajor, missedProbs);
+
+    size_t from = 0;
+    for (size_t i = 0; i < missed.size(); ++i)
+    {
+        const auto& req = missed[i];
+        const size_t n = req.candidatePitches.size();
+        std::copy_n(missedProbs.begin() + (std::ptrdiff_t)from, n, probsOut.begin() + (std::ptrdiff_t)missedOffsets[i]);
+
+        auto scores = std::make_shared<CachedScores>();
+        scores->probs.assign(missedProbs.begin() + (std::ptrdiff_t)from, missedProbs.begin() + (std::ptrdiff_t)(from + n));
+        insert(makeQuery(req.resolvedContext(scratch), req.candidatePitches, keyRoot, isMajor), std::move(scores));
+        from += n;
+    }
+}
+
+ModelCacheStats CachingModelBridge::getStats() const
+{
+    const juce::ScopedLock sl(lock);
+    ModelCacheStats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.evictions = evictions;
+    s.entries = (int)lru.size();
+    s.bytes = totalBytes;
+    return s;
+}
+
+void CachingModelBridge::clear()
+{
+    const juce::ScopedLock sl(lock);
+    lru.clear();
+    index.clear();
+    totalBytes = 0;
+}
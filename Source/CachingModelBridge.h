@@ -0,0 +1,124 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <list>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "ModelBridge.h"
+
+struct ModelCacheStats
+{
+    juce::uint64 hits = 0;
+    juce::uint64 misses = 0;
+    juce::uint64 evictions = 0;
+    int entries = 0;
+    size_t bytes = 0;            // approximate size of the cached results
+
+    double hitRate() const { return (hits + misses) > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+};
+
+// Model output as the cache stores it, shared between every hit. Pitches are relative
+// to the reference pitch of the context that produced them (its last note, or the first
+// candidate if it was empty), and each influence remembers which context note it came
+// from (counted from the end), so one entry serves every transposition and timing of
+// the same line.
+struct CachedScores
+{
+    std::vector<Rationale> rationale;        // empty if only probabilities were asked for
+    std::vector<float> probs;
+    std::vector<int> influenceNotes;         // every influence in order; -1 = not a context note
+    std::vector<int> influenceStart;         // rationale i's influences start here (size + 1 entries)
+};
+
+// Read-only view of a cached result for one call
+struct SharedScores
+{
+    std::shared_ptr<const CachedScores> scores;
+    int reference = 0;                       // added to every stored pitch
+
+    size_t size() const { return scores != nullptr ? scores->probs.size() : 0; }
+    float prob(size_t i) const { return scores->probs[i]; }
+    int candidatePitch(size_t i) const { return scores->rationale[i].candidatePitch + reference; }
+
+    // Full rationale for candidate i, transposed back and timed against context
+    Rationale get(size_t i, std::span<const ContextNote> context) const;
+};
+
+// ModelBridge decorator that remembers results for repeated contexts, e.g. a scale
+// played up and down. The key is an FNV-1a hash of the transposition-normalised
+// context (only the inner model's contextWindow() counts), the candidate set, the key
+// root relative to the same reference and the mode; entries also keep that signature,
+// so a hash collision is a miss rather than a wrong answer. At most maxEntries results,
+// and about maxBytes of them (ModelCacheStats::bytes), are kept, least recently used
+// first out.
+//
+// This relies on the inner model scoring transposed lines (key included) the same way
+// and reading no more than contextWindow() notes, which holds for every backend here.
+// Sessions bypass the cache, so it serves the stateless calls: speculation, which asks
+// about the same lines again whenever a phrase repeats, and explanations.
+class CachingModelBridge : public ModelBridge {
+public:
+    explicit CachingModelBridge(std::shared_ptr<ModelBridge> inner, int maxEntries = 512,
+                                size_t maxBytes = 4 << 20);
+
+    // Shares the cached result instead of copying it
+    SharedScores scoreShared(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                             int keyRoot, bool isMajor);
+
+    std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& context,
+                                           const std::vector<int>& candidatePitches,
+                                           int keyRoot, bool isMajor) override;
+    void scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                            int keyRoot, bool isMajor, std::span<float> probsOut) override;
+    // Answers what it can from the cache and sends the rest to the inner model as one batch
+    void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                    std::span<float> probsOut) override;
+
+    std::unique_ptr<ModelSession> createSession(int keyRoot, bool isMajor) override { return inner->createSession(keyRoot, isMajor); }
+    int contextWindow() const override { return inner->contextWindow(); }
+    bool isThreadSafe() const override { return inner->isThreadSafe(); }
+    bool isTrained() const override { return inner->isTrained(); }
+
+    ModelCacheStats getStats() const;
+    void clear();
+
+private:
+    // Normalised call: tail of the context, reference pitch, key class
+    struct Query
+    {
+        std::span<const ContextNote> context;
+        std::span<const int> candidates;
+        int reference = 0;
+        int keyClass = 0;
+        bool isMajor = true;
+        juce::uint64 hash = 0;
+    };
+
+    struct Entry
+    {
+        juce::uint64 hash;
+        std::vector<int> signature;
+        std::shared_ptr<const CachedScores> scores;
+        size_t bytes;
+    };
+
+    Query makeQuery(std::span<const ContextNote> context, std::span<const int> candidates, int keyRoot, bool isMajor) const;
+    static std::vector<int> signatureOf(const Query& q);
+    static bool matches(const std::vector<int>& signature, const Query& q);
+
+    // Cached result for q; needRationale treats probability-only entries as misses
+    std::shared_ptr<const CachedScores> find(const Query& q, bool needRationale);
+    void insert(const Query& q, std::shared_ptr<const CachedScores> scores);
+    void evictOldest();                      // lock held, lru not empty
+
+    std::shared_ptr<ModelBridge> inner;
+    const int maxEntries;
+    const size_t maxBytes;
+
+    juce::CriticalSection lock;
+    std::list<Entry> lru;                    // most recent first
+    std::unordered_multimap<juce::uint64, std::list<Entry>::iterator> index;
+    size_t totalBytes = 0;
+    juce::uint64 hits = 0, misses = 0, evictions = 0;
+};
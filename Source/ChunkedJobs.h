@@ -0,0 +1,59 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+
+// Splits a batch into contiguous chunks, one per job, across a pool of spare cores.
+// Used where one call does enough independent work to be worth spreading out
+// (occlusion scoring, whole-score rule checks).
+namespace ChunkedJobs
+{
+    // One thread per core beyond the caller's; nullptr on a single core
+    inline std::unique_ptr<juce::ThreadPool> makePool(const juce::String& threadName)
+    {
+        const int cpus = juce::SystemStats::getNumCpus();
+        if (cpus <= 1)
+            return nullptr;
+        return std::make_unique<juce::ThreadPool>(juce::ThreadPoolOptions{}
+                                                      .withThreadName(threadName)
+                                                      .withNumberOfThreads(cpus - 1));
+    }
+
+    // Jobs for numItems: none smaller than minItemsPerJob, at most one per pool thread
+    // plus the caller, and always at least one
+    inline int jobsFor(const juce::ThreadPool* pool, size_t numItems, size_t minItemsPerJob)
+    {
+        if (pool == nullptr)
+            return 1;
+        const size_t limit = (size_t)pool->getNumThreads() + 1;
+        return (int)juce::jlimit<size_t>(1, limit, numItems / juce::jmax<size_t>(1, minItemsPerJob));
+    }
+
+    // Calls job(i) for every i in [0, numJobs) and returns once all have finished. The
+    // caller's thread takes job 0; the rest go to the pool (or run here without one).
+    template <typename Job>
+    void runChunked(juce::ThreadPool* pool, int numJobs, Job&& job)
+    {
+        if (pool == nullptr || numJobs <= 1)
+        {
+            for (int i = 0; i < numJobs; ++i)
+                job(i);
+            return;
+        }
+
+        std::atomic<int> remaining { numJobs - 1 };
+        juce::WaitableEvent allDone;
+        for (int i = 1; i < numJobs; ++i)
+        {
+            pool->addJob([&, i]
+            {
+                job(i);
+                if (--remaining == 0)
+                    allDone.signal();
+            });
+        }
+
+        job(0);
+        allDone.wait();
+    }
+}
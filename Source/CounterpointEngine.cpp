@@ -1,237 +1,403 @@
 #include "CounterpointEngine.h"
+#include "IntervalTables.h"
+#include "TraceRing.h"
 
-CounterpointEngine::CounterpointEngine() {
-    model = ModelBridge::createMock();
+CounterpointEngine::CounterpointEngine(std::shared_ptr<ModelBridge> sharedModel)
+    : model(sharedModel != nullptr ? std::move(sharedModel) : ModelBridge::createDefault())
+{
+    inference = std::make_unique<InferencePool>(*model, 1);
+    modelSession = inference->openSession(keyRoot, keyIsMajor);
+    speculationModel = std::make_unique<CachingModelBridge>(model);
+    speculator = std::make_unique<Speculator>(speculationModel.get());
+
+    // Sized once so note-ons never allocate: the pair the search looks back at plus room
+    // for it to push the candidate and its lookahead levels
+    activePairs.fill(-1);
+    searchPath.reserve(BeamSearch::historyNeeded + 16);
+}
+
+CounterpointEngine::~CounterpointEngine() = default;
+
+void CounterpointEngine::setSpeculationEnabled(bool enabled)
+{
+    if (enabled && !speculator)
+    {
+        speculator = std::make_unique<Speculator>(speculationModel.get());
+        historyChanged();
+    }
+    else if (!enabled)
+    {
+        speculator.reset();
+    }
+}
+
+SpeculationStats CounterpointEngine::getSpeculationStats() const
+{
+    return speculator ? speculator->getStats() : SpeculationStats{};
+}
+
+void CounterpointEngine::setKey(int root, bool isMajor)
+{
+    keyRoot = root;
+    keyIsMajor = isMajor;
+    rebuildModelSession();
+    historyChanged();
+}
+
+void CounterpointEngine::resetPhrase()
+{
+    timeline.clear();
+    lastChord = {};
+    lastInputNote = -1;
+    lastGeneratedNote = -1;
+    lateModelScores.release();
+    modelSessionStale = !inference->resetSession(modelSession, keyRoot, keyIsMajor);
+    historyChanged();
+}
+
+void CounterpointEngine::commitToHistory(const NotePair& pair)
+{
+    timeline.push(pair);
+    if (!inference->append(modelSession, timeline.line(SessionTimeline::generatedVoice).back()))
+        modelSessionStale = true;
+}
+
+// Sessions are keyed, so a key change (or a dropped update) re-encodes the remembered line
+void CounterpointEngine::rebuildModelSession()
+{
+    bool ok = inference->resetSession(modelSession, keyRoot, keyIsMajor);
+    for (const auto& note : timeline.line(SessionTimeline::generatedVoice))
+        ok = ok && inference->append(modelSession, note);
+    modelSessionStale = !ok;
+}
+
+bool CounterpointEngine::takeLateModelResult(LateModelResult& result)
+{
+    if (!lateModelScores.isReady())
+        return false;
+
+    const auto candidates = lateModelScores.getCandidates();
+    const auto probs = lateModelScores.getProbabilities();
+    lateModelResult.generatedProb = -1.0f;
+    lateModelResult.preferredProb = -1.0f;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (probs[i] > lateModelResult.preferredProb)
+        {
+            lateModelResult.preferredProb = probs[i];
+            lateModelResult.preferredPitch = candidates[i];
+        }
+        if (candidates[i] == lateModelResult.generatedPitch)
+            lateModelResult.generatedProb = probs[i];
+    }
+
+    lateModelScores.release();
+    result = lateModelResult;
+    return true;
+}
+
+void CounterpointEngine::historyChanged()
+{
+    // Bumping the version invalidates every speculative answer computed so far
+    ++historyVersion;
+
+    if (speculator && lastInputNote >= 0)
+        speculator->submit(timeline.view(), lastInputNote, generateAbove, keyRoot, keyIsMajor, modelBlending,
+                           beamSearch.getConfig(), historyVersion);
 }
 
 juce::MidiMessage CounterpointEngine::generateCounterpoint(const juce::MidiMessage& userMsg)
+{
+    return generateCounterpoint(userMsg, 0);
+}
+
+juce::MidiMessage CounterpointEngine::generateCounterpoint(const juce::MidiMessage& userMsg, int budgetMicros)
 {
     const int inPitch = userMsg.getNoteNumber();
     double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
 
-    int validPitch = generateValidCounterpoint(inPitch, now);
+    int validPitch = generateValidCounterpoint(inPitch, now, budgetMicros);
     
-    activePairs[inPitch] = validPitch;
-    int interval = std::abs(validPitch - inPitch) % 12;
-    std::cout << "Generated valid counterpoint: input=" << inPitch << " -> generated=" << validPitch 
-              << " (interval: " << ruleChecker.intervalName(interval).toStdString() << ")" << std::endl;
-    std::cout << "activePairs size after generation=" << activePairs.size() << std::endl;
+    activePairs[(size_t)inPitch] = validPitch;
+    commitToHistory({ inPitch, validPitch, now });
+    PM_TRACE(TraceEvent::Committed, inPitch, validPitch);
 
-    history.push_back({ inPitch, validPitch, now });
-    if (history.size() > 32) history.pop_front();
+    lastInputNote = inPitch;
+    lastGeneratedNote = validPitch;
+    historyChanged();
 
     return juce::MidiMessage::noteOn(1, validPitch, userMsg.getVelocity());
 }
 
 juce::MidiMessage CounterpointEngine::noteOffForInput(int inputPitch)
 {
-    std::cout << "noteOffForInput called with inputPitch=" << inputPitch << std::endl;
-    std::cout << "activePairs size=" << activePairs.size() << std::endl;
-    for (const auto& pair : activePairs)
-    {
-        std::cout << "  activePairs[" << pair.first << "] = " << pair.second << std::endl;
-    }
-    
-    auto it = activePairs.find(inputPitch);
-    if (it == activePairs.end())
+    const int genPitch = (inputPitch >= 0 && inputPitch < 128) ? activePairs[(size_t)inputPitch] : -1;
+    if (genPitch < 0)
     {
-        std::cout << "No mapping found for inputPitch=" << inputPitch << std::endl;
+        PM_TRACE(TraceEvent::NoMapping, inputPitch, -1);
         return juce::MidiMessage();
     }
 
-    int genPitch = it->second;
-    activePairs.erase(it);
-    
-    std::cout << "Found mapping: input=" << inputPitch << " -> generated=" << genPitch << std::endl;
+    activePairs[(size_t)inputPitch] = -1;
+    PM_TRACE(TraceEvent::NoteOff, inputPitch, genPitch);
 
     return juce::MidiMessage::noteOff(1, genPitch);
 }
 
+std::vector<juce::MidiMessage> CounterpointEngine::generateVoices(const juce::MidiMessage& userMsg, int budgetMicros)
+{
+    if (voiceCount <= 2)
+        return { generateCounterpoint(userMsg, budgetMicros) };
+
+    const int inPitch = userMsg.getNoteNumber();
+    double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+    // Input is the bass when generating above, the top voice when generating below
+    auto result = voiceSearch.search(inPitch, voiceCount, generateAbove,
+                                     lastChord.numVoices > 0 ? &lastChord : nullptr);
+    const auto& chord = result.chord;
+    const int inputVoice = generateAbove ? 0 : chord.numVoices - 1;
+    const int outerVoice = generateAbove ? chord.numVoices - 1 : 0;
+
+    lastStats.nodesExpanded = result.nodesExpanded;
+    lastStats.score = -result.cost;
+    lastStats.legal = result.legal;
+
+    lastChord = chord;
+    activeVoicings[(size_t)inPitch] = chord;
+
+    PM_TRACE(TraceEvent::Voicing, inPitch, chord.pitches[outerVoice], result.nodesExpanded, -result.cost,
+             (juce::uint8)((result.legal ? TraceFlags::legal : 0) | (generateAbove ? TraceFlags::above : 0)));
+
+    // Outer generated voice stands in for the two-voice history
+    commitToHistory({ inPitch, chord.pitches[outerVoice], now });
+
+    lastInputNote = inPitch;
+    lastGeneratedNote = chord.pitches[outerVoice];
+    historyChanged();
+
+    std::vector<juce::MidiMessage> messages;
+    for (int v = 0; v < chord.numVoices; ++v)
+        if (v != inputVoice)
+            messages.push_back(juce::MidiMessage::noteOn(1, chord.pitches[v], userMsg.getVelocity()));
+    return messages;
+}
+
+std::vector<juce::MidiMessage> CounterpointEngine::noteOffsForInput(int inputPitch)
+{
+    std::vector<juce::MidiMessage> messages;
+
+    if (inputPitch < 0 || inputPitch >= 128 || activeVoicings[(size_t)inputPitch].numVoices == 0)
+    {
+        auto single = noteOffForInput(inputPitch);
+        if (single.isNoteOff())
+            messages.push_back(single);
+        return messages;
+    }
+
+    auto& chord = activeVoicings[(size_t)inputPitch];
+    for (int v = 0; v < chord.numVoices; ++v)
+        if (chord.pitches[v] != inputPitch)
+            messages.push_back(juce::MidiMessage::noteOff(1, chord.pitches[v]));
+
+    chord = {};
+    return messages;
+}
+
 bool CounterpointEngine::isTritone(int inputPitch, int generatedPitch) const
 {
-    int interval = std::abs(generatedPitch - inputPitch) % 12;
-    return (interval == 6);
+    return IntervalTables::isTritone(generatedPitch - inputPitch);
 }
 
-int CounterpointEngine::generateValidCounterpoint(int inputPitch, double now)
+InferencePool::Future CounterpointEngine::requestModelScores(int inputPitch, juce::int64 deadlineTicks)
 {
-    struct IntervalOption {
-        int semitones;
-        float weight;
-    };
+    int pitches[BeamSearch::maxCandidates];
+    int n = beamSearch.candidatePitches(inputPitch, generateAbove, pitches);
+    if (n == 0)
+        return {};
 
-    static std::vector<IntervalOption> consonantIntervals = {
-        {3, 0.25f},
-        {4, 0.25f},
-        {7, 0.10f},
-        {8, 0.20f},
-        {9, 0.15f},
-        {12, 0.05f}
-    };
+    if (modelSessionStale)
+        rebuildModelSession();
 
-    auto chooseWeightedInterval = [&]() -> int {
-        float total = 0.f;
-        for (auto& i : consonantIntervals)
-            total += i.weight;
+    // The session on the inference lane already holds the generated line so far
+    return inference->score(modelSession, { pitches, (size_t)n }, deadlineTicks);
+}
 
-        float r = juce::Random::getSystemRandom().nextFloat() * total;
-        for (auto& i : consonantIntervals)
-        {
-            if (r < i.weight) return i.semitones;
-            r -= i.weight;
-        }
-        return consonantIntervals[0].semitones;
+void CounterpointEngine::applyModelScores(const InferencePool::Future& scores)
+{
+    const auto candidates = scores.getCandidates();
+    const auto probs = scores.getProbabilities();
+
+    modelBias.fill(0.0f);
+    for (size_t i = 0; i < candidates.size(); ++i)
+        modelBias[(size_t)candidates[i]] = SearchLimits::modelWeight * probs[i];
+}
+
+SearchResult CounterpointEngine::searchWithinBudget(int inputPitch, double now, int budgetMicros)
+{
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    SearchLimits limits;
+    if (budgetMicros > 0)
+        limits.deadlineTicks = startTicks + juce::Time::secondsToHighResolutionTicks(budgetMicros * 1.0e-6);
+
+    auto timeLeft = [&limits] {
+        return limits.deadlineTicks == 0 || juce::Time::getHighResolutionTicks() < limits.deadlineTicks;
     };
 
-    int motion = 0;
-    if (lastInputNote != -1)
+    // 0) Ask the model first, so it runs on its own thread alongside the rule-only search
+    InferencePool::Future modelScores;
+    if (modelBlending)
     {
-        if (inputPitch > lastInputNote) motion = -1;
-        else if (inputPitch < lastInputNote) motion = 1;
-        else motion = juce::Random::getSystemRandom().nextBool() ? 1 : -1;
+        juce::int64 modelDeadline = startTicks + juce::Time::secondsToHighResolutionTicks(modelDeadlineMicros * 1.0e-6);
+        if (limits.deadlineTicks != 0)
+            modelDeadline = juce::jmin(modelDeadline, limits.deadlineTicks);
+        modelScores = requestModelScores(inputPitch, modelDeadline);
     }
-    else motion = juce::Random::getSystemRandom().nextBool() ? 1 : -1;
 
-    int genNote = inputPitch;
-    int tries = 0;
-    
-    while (tries < 8)
+    searchPath.clear();
+    timeline.view().last(BeamSearch::historyNeeded).appendTo(searchPath);
+
+    // 1) Cheap rule-only answer, always available
+    SearchResult result = beamSearch.search(searchPath, inputPitch, generateAbove, now, limits);
+    lastStats.nodesExpanded = result.nodesExpanded;
+
+    // 2) Blend in model probabilities for the same candidates, if they come in time.
+    // Late ones are kept for the explanation only.
+    const bool modelInTime = modelScores.waitUntilDeadline();
+    if (modelScores.isValid() && !modelInTime)
     {
-        bool valid = true;
-        int interval = chooseWeightedInterval();
-        
-        if (generateAbove)
-            genNote = inputPitch + interval;
-        else
-            genNote = inputPitch - interval;
-        
-        if (genNote < 24 || genNote > 96)
-        {
-            if (generateAbove && genNote > 96)
-                genNote = inputPitch + interval - 12;
-            else if (!generateAbove && genNote < 24)
-                genNote = inputPitch - interval + 12;
-            
-            if (genNote < 24 || genNote > 96)
-            {
-                if (generateAbove)
-                    genNote = inputPitch - interval;
-                else
-                    genNote = inputPitch + interval;
-            }
-        }
+        lastStats.modelLate = true;
+        lateModelResult = { inputPitch };
+        lateModelScores = std::move(modelScores);
+    }
 
-        if (isTritone(inputPitch, genNote))
-        {
-            valid = false;
-            std::cout << "🚫 Tritone interval detected, retrying... (attempt " << (tries + 1) << ")" << std::endl;
-        }
-        
-        if (valid && lastGeneratedNote != -1 && lastInputNote != -1)
-        {
-            int currentInterval = std::abs(genNote - inputPitch) % 12;
-            int prevInterval = std::abs(lastGeneratedNote - lastInputNote) % 12;
-
-            bool sameDirection =
-                ((genNote > lastGeneratedNote && inputPitch > lastInputNote) ||
-                 (genNote < lastGeneratedNote && inputPitch < lastInputNote));
-
-            if (sameDirection &&
-                ((prevInterval == 7 && currentInterval == 7) ||
-                 (prevInterval == 0 && currentInterval == 0)))
-            {
-                valid = false;
-                std::cout << "🚫 Parallel perfect interval detected, retrying... (attempt " << (tries + 1) << ")" << std::endl;
-            }
-        }
+    if (modelInTime && timeLeft())
+    {
+        applyModelScores(modelScores);
+        limits.pitchBias = modelBias.data();
+        result = beamSearch.search(searchPath, inputPitch, generateAbove, now, limits);
+        lastStats.nodesExpanded += result.nodesExpanded;
+        lastStats.stage = RefinementStage::ModelScored;
+        lastStats.modelScored = true;
+    }
 
-        if (valid) break;
+    // 3) Deepen the lookahead one level at a time; keep the last level that finished
+    for (int depth = 1; depth <= beamSearch.getConfig().lookaheadDepth && timeLeft(); ++depth)
+    {
+        limits.depth = depth;
+        SearchResult deeper = beamSearch.search(searchPath, inputPitch, generateAbove, now, limits);
+        lastStats.nodesExpanded += deeper.nodesExpanded;
+        if (!deeper.complete)
+            break;
 
-        tries++;
-        motion = juce::Random::getSystemRandom().nextBool() ? 1 : -1;
+        result = deeper;
+        lastStats.stage = RefinementStage::Lookahead;
+        lastStats.depthReached = depth;
     }
 
-    const int minSeparation = 3;
+    lastStats.score = result.score;
+    lastStats.legal = result.legal;
+    lastStats.elapsedMicros = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+    return result;
+}
+
+int CounterpointEngine::generateValidCounterpoint(int inputPitch, double now, int budgetMicros)
+{
+    lastStats = {};
 
-    if (generateAbove)
+    // An answer precomputed between notes for exactly this history wins outright
+    // (it ran the full lookahead, with the model's bias if the model could be shared)
+    const auto speculated = speculator ? speculator->lookup(historyVersion, inputPitch, generateAbove) : Speculator::Answer{};
+    int genNote = speculated.pitch;
+    if (genNote >= 0)
     {
-        if (genNote <= inputPitch + minSeparation)
-        {
-            genNote = inputPitch + 7;
-            std::cout << "🔧 Voice crossing prevention: pushed above to " << genNote << std::endl;
-        }
+        lastStats.speculated = true;
+        lastStats.modelScored = speculated.modelScored;
+        lastStats.legal = speculated.legal;
+        lastStats.score = speculated.score;
+        lastStats.stage = RefinementStage::Lookahead;
+        lastStats.depthReached = beamSearch.getConfig().lookaheadDepth;
     }
     else
     {
-        if (genNote >= inputPitch - minSeparation)
-        {
-            genNote = inputPitch - 7;
-            std::cout << "🔧 Voice crossing prevention: pushed below to " << genNote << std::endl;
-        }
-    }
-
-    genNote = juce::jlimit(36, 84, genNote);
-    
-    if (isTritone(inputPitch, genNote))
-    {
-        std::cout << "🚫 Final tritone check failed, using fallback" << std::endl;
-        if (generateAbove)
-            genNote = inputPitch + 4;
-        else
-            genNote = inputPitch - 4;
-        
-        genNote = juce::jlimit(36, 84, genNote);
+        SearchResult result = searchWithinBudget(inputPitch, now, budgetMicros);
+        genNote = result.pitch;
+        if (lastStats.modelLate)
+            lateModelResult.generatedPitch = genNote;
     }
 
-    std::cout << "🎵 Generated note: " << genNote << " (interval=" << std::abs(genNote - inputPitch) % 12 
-              << ", direction=" << (generateAbove ? "above" : "below") << ", attempts=" << (tries + 1) << ")" << std::endl;
+    if (!lastStats.legal)
+        PM_TRACE(TraceEvent::NoLegalCandidate, inputPitch, genNote, lastStats.nodesExpanded, lastStats.score);
 
-    history.push_back({inputPitch, genNote, now});
-    
-    if (history.size() > 50)
-        history.erase(history.begin(), history.begin() + 10);
+    PM_TRACE(TraceEvent::Generated, inputPitch, genNote, lastStats.nodesExpanded, lastStats.score,
+             (juce::uint8)((lastStats.legal ? TraceFlags::legal : 0)
+                           | (lastStats.speculated ? TraceFlags::speculated : 0)
+                           | (generateAbove ? TraceFlags::above : 0)),
+             lastStats.depthReached);
 
+    // The caller records the pair once it is committed
     return genNote;
 }
 
-int CounterpointEngine::suggestAlternativeNote(int inputPitch, int rejectedPitch, double now)
+int CounterpointEngine::suggestAlternativeNote(int inputPitch, int rejectedPitch)
 {
-    std::vector<std::pair<int, float>> consonantIntervals = {
+    struct Alternative { int pitch; float weight; };
+    constexpr Alternative consonantIntervals[] = {
         {3, 1.0f}, {4, 1.0f}, {8, 0.9f}, {9, 0.9f}, {12, 0.8f}, {7, 0.6f}, {0, 0.5f}
     };
     
-    std::vector<std::pair<int, float>> alternatives;
+    Alternative alternatives[2 * std::size(consonantIntervals) + 4];
+    int numAlternatives = 0;
     
     for (const auto& [interval, weight] : consonantIntervals) {
         int above = inputPitch + interval;
         int below = inputPitch - interval;
-        if (above >= 24 && above <= 96) alternatives.push_back({above, weight});
-        if (below >= 24 && below <= 96) alternatives.push_back({below, weight});
+        if (above >= 24 && above <= 96) alternatives[numAlternatives++] = {above, weight};
+        if (below >= 24 && below <= 96) alternatives[numAlternatives++] = {below, weight};
     }
     
-    if (!history.empty()) {
-        const NotePair& lastPair = history.back();
-        int lastGenPitch = lastPair.generatedPitch;
+    if (!timeline.empty()) {
+        int lastGenPitch = timeline.back().generatedPitch;
         for (int step = 1; step <= 2; ++step) {
             int stepUp = lastGenPitch + step;
             int stepDown = lastGenPitch - step;
-            if (stepUp >= 24 && stepUp <= 96) alternatives.push_back({stepUp, 0.7f});
-            if (stepDown >= 24 && stepDown <= 96) alternatives.push_back({stepDown, 0.7f});
+            if (stepUp >= 24 && stepUp <= 96) alternatives[numAlternatives++] = {stepUp, 0.7f};
+            if (stepDown >= 24 && stepDown <= 96) alternatives[numAlternatives++] = {stepDown, 0.7f};
         }
     }
     
+    // Drop rejected/tritone alternatives, then score the rest with the model in one batch
+    int kept = 0;
+    for (int i = 0; i < numAlternatives; ++i)
+        if (alternatives[i].pitch != rejectedPitch && !isTritone(inputPitch, alternatives[i].pitch))
+            alternatives[kept++] = alternatives[i];
+    
+    int altPitches[std::size(alternatives)];
+    float probs[std::size(alternatives)];
+    for (int i = 0; i < kept; ++i)
+    {
+        altPitches[i] = alternatives[i].pitch;
+        probs[i] = 0.5f;
+    }
+
+    // Model scores count only if they arrive within the model deadline
+    const juce::int64 deadline = juce::Time::getHighResolutionTicks()
+                               + juce::Time::secondsToHighResolutionTicks(modelDeadlineMicros * 1.0e-6);
+    auto scores = inference->scoreEach({}, { altPitches, (size_t)kept }, keyRoot, keyIsMajor, deadline);
+    if (scores.waitUntilDeadline())
+        std::copy(scores.getProbabilities().begin(), scores.getProbabilities().end(), probs);
+    
+    // Rules for every alternative in one pass over the committed history
+    static_assert(std::size(alternatives) <= RuleChecker::maxBatchCandidates);
+    float ruleScores[std::size(alternatives)];
+    ruleChecker.evaluateBatch(timeline.view(), inputPitch, { altPitches, (size_t)kept }, ruleScores);
+    
     float bestScore = -1.0f;
     int bestAlternative = inputPitch;
     
-    for (const auto& [alt, baseWeight] : alternatives) {
-        if (alt == rejectedPitch) continue;
-        if (isTritone(inputPitch, alt)) continue;
-        
-        float ruleScore = ruleChecker.evaluateScore(
-            std::vector<NotePair>(history.begin(), history.end()), inputPitch, alt, now);
-        auto rationale = model->scoreCandidates({}, {alt}, 0, true);
-        float prob = rationale.empty() ? 0.5f : rationale[0].prob;
-        float combined = (ruleScore * prob * baseWeight);
+    for (int i = 0; i < kept; ++i) {
+        const auto [alt, baseWeight] = alternatives[i];
+        float combined = (ruleScores[i] * probs[i] * baseWeight);
         
         if (combined > bestScore)
         {
@@ -240,6 +406,6 @@ int CounterpointEngine::suggestAlternativeNote(int inputPitch, int rejectedPitch
         }
     }
     
-    std::cout << "Suggested alternative: " << bestAlternative << " (score: " << bestScore << ")" << std::endl;
+    PM_TRACE(TraceEvent::Alternative, inputPitch, bestAlternative, numAlternatives, bestScore);
     return bestAlternative;
 }
\ No newline at end of file
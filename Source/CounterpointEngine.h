@@ -1,41 +1,131 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
-#include <deque>
-#include <unordered_map>
+#include <array>
+#include "SessionTimeline.h"
 #include "RuleChecker.h"
+#include "InferencePool.h"
 #include "ModelBridge.h"
+#include "CachingModelBridge.h"
+#include "BeamSearch.h"
+#include "VoiceLeadingSearch.h"
+#include "Speculator.h"
 
-struct NotePair
+// How far deadline-bounded generation got before it had to answer. Lookahead can follow
+// either of the others, so whether the model took part is in GenerationStats::modelScored.
+enum class RefinementStage { RuleOnly, ModelScored, Lookahead };
+
+// Search statistics for the most recently generated note
+struct GenerationStats
 {
-    int inputPitch;
-    int generatedPitch;
-    double timestamp;
-    
-    NotePair(int input, int generated, double time) 
-        : inputPitch(input), generatedPitch(generated), timestamp(time) {}
+    int nodesExpanded = 0;
+    float score = 0.0f;
+    bool legal = true;
+    RefinementStage stage = RefinementStage::RuleOnly;
+    int depthReached = 0;        // deepest lookahead completed
+    double elapsedMicros = 0.0;
+    bool speculated = false;     // answered from the background speculation table
+    bool modelScored = false;    // model probabilities were blended into the answer
+    bool modelLate = false;      // model missed its deadline; the answer is rule-based
+};
+
+// Model scores that arrived after their note was already generated. They cannot change
+// that note, so they are only reported alongside its explanation.
+struct LateModelResult
+{
+    int inputPitch = -1;
+    int generatedPitch = -1;
+    int preferredPitch = -1;           // model's favourite candidate
+    float preferredProb = 0.0f;
+    float generatedProb = -1.0f;       // -1 if the generated pitch was not a model candidate
 };
 
 class CounterpointEngine {
 public:
-    CounterpointEngine();
+    // Without a model, opens ModelBridge::createDefault() for itself
+    explicit CounterpointEngine(std::shared_ptr<ModelBridge> model = nullptr);
+    ~CounterpointEngine();
 
+    // Rules and lookahead, plus the model's probabilities if blending is on
     juce::MidiMessage generateCounterpoint(const juce::MidiMessage& userMsg);
+    // Anytime variant: answers within budgetMicros (<= 0 runs every stage to completion)
+    juce::MidiMessage generateCounterpoint(const juce::MidiMessage& userMsg, int budgetMicros);
     juce::MidiMessage noteOffForInput(int inputPitch);
+
+    // One note-on per generated voice; with two voices this is just generateCounterpoint,
+    // under budgetMicros like its anytime variant
+    std::vector<juce::MidiMessage> generateVoices(const juce::MidiMessage& userMsg, int budgetMicros = 0);
+    std::vector<juce::MidiMessage> noteOffsForInput(int inputPitch);
     
-    void setGenerateAbove(bool above) { generateAbove = above; }
+    void setGenerateAbove(bool above) { generateAbove = above; historyChanged(); }
+    bool getGenerateAbove() const { return generateAbove; }
+    void setSearchConfig(const SearchConfig& config) { beamSearch.setConfig(config); historyChanged(); }
+    void setKey(int root, bool isMajor);
+    // Model probabilities only shape the answer when blending is on (it is off by default).
+    // Turn it on for a trained model; the fallback mock's scores are noise.
+    void setModelBlending(bool enabled) { modelBlending = enabled; historyChanged(); }
+    bool getModelBlending() const { return modelBlending; }
+    bool hasTrainedModel() const { return model->isTrained(); }
+    // Forgets the phrase so far (history, model context, last chord); held notes keep their note-offs
+    void resetPhrase();
+
+    // Background precomputation of likely next answers (on by default)
+    void setSpeculationEnabled(bool enabled);
+    SpeculationStats getSpeculationStats() const;
+    const GenerationStats& getLastStats() const { return lastStats; }
+    // The committed phrase; the model context, rules and explanations all read this
+    const SessionTimeline& getTimeline() const { return timeline; }
+
+    // How long the model may take per note (default 2 ms). Past this the note is chosen by
+    // the rules alone, also when generateCounterpoint runs without a budget.
+    void setModelDeadline(int micros) { modelDeadlineMicros = juce::jmax(0, micros); }
+    InferenceStats getInferenceStats() const { return inference->getStats(); }
+    // The cache in front of speculation's model calls
+    ModelCacheStats getModelCacheStats() const { return speculationModel->getStats(); }
+    // Hands over the most recent late model result once it has arrived
+    bool takeLateModelResult(LateModelResult& result);
+
+    // Total voices including the input (2 = classic two-voice counterpoint, up to 4 for SATB)
+    void setVoiceCount(int voices) { voiceCount = juce::jlimit(2, VoiceLeadingSearch::maxVoices, voices); }
+    int getVoiceCount() const { return voiceCount; }
 
 private:
-    int generateValidCounterpoint(int inputPitch, double now);
-    int suggestAlternativeNote(int inputPitch, int rejectedPitch, double now);
+    int generateValidCounterpoint(int inputPitch, double now, int budgetMicros);
+    SearchResult searchWithinBudget(int inputPitch, double now, int budgetMicros);
+    void historyChanged();
+    void commitToHistory(const NotePair& pair);
+    void rebuildModelSession();
+    InferencePool::Future requestModelScores(int inputPitch, juce::int64 deadlineTicks);
+    void applyModelScores(const InferencePool::Future& scores);
+    int suggestAlternativeNote(int inputPitch, int rejectedPitch);
     bool isTritone(int inputPitch, int generatedPitch) const;
 
     RuleChecker ruleChecker;
-    std::unique_ptr<ModelBridge> model;
-    std::deque<NotePair> history;
-    std::unordered_map<int, int> activePairs;
+    BeamSearch beamSearch;
+    VoiceLeadingSearch voiceSearch;
+    std::shared_ptr<ModelBridge> model;
+    SessionTimeline timeline;
+    std::vector<NotePair> searchPath;        // reserved up front; reused for every search
+    std::unique_ptr<InferencePool> inference;      // declared after model, so it stops first
+    int modelSession = -1;                         // generated line so far, encoded on the inference lane
+    bool modelSessionStale = false;                // an update was dropped; re-encode before scoring
+    int modelDeadlineMicros = 2000;
+    InferencePool::Future lateModelScores;
+    LateModelResult lateModelResult;
+    std::array<float, 128> modelBias {};
+    GenerationStats lastStats;
+    std::array<int, 128> activePairs;        // generated pitch per held input, -1 = none
+    std::array<VoiceLeadingSearch::Chord, 128> activeVoicings {};   // numVoices == 0 = none
+    VoiceLeadingSearch::Chord lastChord;
+    std::unique_ptr<CachingModelBridge> speculationModel;   // speculation scores the same lines over and over
+    std::unique_ptr<Speculator> speculator;
+    juce::uint64 historyVersion = 0;
     
     int lastGeneratedNote = -1;
     int lastInputNote = -1;
     bool generateAbove = true;
+    int voiceCount = 2;
+    int keyRoot = 0;
+    bool keyIsMajor = true;
+    bool modelBlending = false;
 };
\ No newline at end of file
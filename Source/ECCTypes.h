@@ -4,9 +4,11 @@
 
 enum class ViolationKind {
     ParallelFifth, ParallelOctave, VoiceCrossing, LargeLeap, DissonanceOnStrongBeat,
-    HiddenFifthOctave, DirectMotionToPerfect, RangeExceeded, Consonance, Other
+    HiddenFifthOctave, DirectMotionToPerfect, RangeExceeded, Consonance, FinalSonority, Other
 };
 
+// A rule result as a code plus the numbers its message needs. Text is rendered only
+// when shown (RuleChecker::describe / suggest), so evaluating rules builds no strings.
 struct Violation {
     ViolationKind kind;
     float severity;
@@ -14,8 +16,8 @@ struct Violation {
     int notePrev;
     int noteInput;
     double time;
-    juce::String description;
-    juce::String suggestion;
+    int intervalFrom;         // semitones between the voices before the move, -1 if none
+    int intervalTo;           // semitones between the voices now
     float weight;
 };
 
@@ -35,12 +37,3 @@ struct Rationale {
     std::vector<Influence> influences;  // what in the context mattered
     std::vector<Violation> triggeredRules; // rules at play
 };
-
-// NotePair for explanation system (includes time)
-struct ExplanationNotePair { 
-    int input; 
-    int gen; 
-    double timeSec; 
-    
-    ExplanationNotePair(int i, int g, double t) : input(i), gen(g), timeSec(t) {}
-};
@@ -1,24 +1,41 @@
 #include "ExplanationEngine.h"
+#include "ChunkedJobs.h"
 #include <algorithm>
 
-ExplanationEngine::ExplanationEngine(){ model = ModelBridge::createMock(); }
+namespace
+{
+    constexpr size_t minRequestsPerJob = 32;   // a request is a few microseconds of model time
+}
+
+ExplanationEngine::ExplanationEngine(std::shared_ptr<ModelBridge> shared)
+{
+    if (shared == nullptr)
+        shared = ModelBridge::createDefault();
+    model = std::make_unique<CachingModelBridge>(std::move(shared));
+    if (model->isThreadSafe())
+        pool = ChunkedJobs::makePool("Occlusion");
+}
 
 static std::vector<int> candidateSet(int p){
     return std::vector<int>{ p-9, p-8, p-5, p-4, p-3, p+3, p+4, p+5, p+8, p+9 };
 }
 
-Rationale ExplanationEngine::explainChoice(const std::vector<ExplanationNotePair>& hist,
-    const std::vector<ContextNote>& ctx, int inPitch, int genPitch,
+Rationale ExplanationEngine::explainChoice(const TimelineView& hist, int inPitch, int genPitch,
     int keyRoot, bool isMajor, double nowSec, bool inPhrase)
 {
+    const auto ctx = hist.generated;
+
     // 1) Rule violations
     auto v = rules.evaluate(hist, inPitch, genPitch, nowSec, inPhrase);
 
     // 2) Model probabilities & influences for this candidate
-    auto rlist = model->scoreCandidates(ctx, candidateSet(inPitch), keyRoot, isMajor);
+    // (shared from the cache; only the chosen candidate's rationale is copied)
+    const auto candidates = candidateSet(inPitch);
+    const auto scores = model->scoreShared(ctx, candidates, keyRoot, isMajor);
     Rationale chosen = {};
-    for (auto& r : rlist) if (r.candidatePitch == genPitch) { chosen = r; break; }
-    if (chosen.candidatePitch < 0 && !rlist.empty()) chosen = rlist[0];
+    for (size_t i = 0; i < scores.size(); ++i)
+        if (scores.candidatePitch(i) == genPitch) { chosen = scores.get(i, ctx); break; }
+    if (chosen.candidatePitch < 0 && scores.size() > 0) chosen = scores.get(0, ctx);
 
     // 3) Augment text
     juce::String why = "Model favors consonant contrary motion; ";
@@ -26,43 +43,74 @@ Rationale ExplanationEngine::explainChoice(const std::vector<ExplanationNotePair
     chosen.summary = why;
     chosen.detail = "Top influences are most recent notes; diatonic bias applied.";
 
-    for (auto& vi : v) chosen.triggeredRules.push_back(vi);
+    // Rule text is only rendered here, where it is shown
+    for (auto& vi : v) {
+        chosen.detail += "\n" + RuleChecker::describe(vi);
+        const auto fix = RuleChecker::suggest(vi);
+        if (fix.isNotEmpty())
+            chosen.detail += " " + fix;
+        chosen.triggeredRules.push_back(vi);
+    }
 
     // 4) Cheap occlusion: drop each influence and observe delta-prob (mocked)
-    chosen = occlusionExplain(ctx, chosen, keyRoot, isMajor);
+    chosen = occlusionExplain(ctx, candidates, chosen, keyRoot, isMajor);
     return chosen;
 }
 
-Rationale ExplanationEngine::occlusionExplain(const std::vector<ContextNote>& ctx,
+Rationale ExplanationEngine::occlusionExplain(std::span<const ContextNote> ctx, std::span<const int> candidates,
                                               const Rationale& base, int keyRoot, bool isMajor)
 {
     Rationale r = base;
-    if (ctx.size() < 2) return r;
+    const auto chosenAt = std::find(candidates.begin(), candidates.end(), r.candidatePitch);
+    if (ctx.size() < 2 || chosenAt == candidates.end()) return r;
+
+    // Models normalise over the candidates they are given, so each masked context is scored
+    // against the same set as r.prob and the chosen pitch's share is read back from it
+    const size_t chosen = (size_t)(chosenAt - candidates.begin());
+
+    // Re-score by masking last-k notes to estimate importance. Every request masks one
+    // index of the same context, so nothing is copied per position, and all K go in one batch
+    const int K = occlusionDepth > 0 ? std::min<int>(occlusionDepth, (int)ctx.size()) : (int)ctx.size();
+    std::vector<ScoreRequest> requests((size_t)K);
+    std::vector<float> probs((size_t)K * candidates.size(), 0.0f);
 
-    // Re-score by masking last-k notes to estimate importance
-    const int K = std::min<int>(5, (int)ctx.size());
     for (int k=0; k<K; ++k) {
-        std::vector<ContextNote> masked = ctx;
         // mask note k-from-end
-        auto idx = (int)masked.size()-1-k;
-        auto erased = masked[idx];
-        masked.erase(masked.begin()+idx);
-        auto rescored = model->scoreCandidates(masked, {r.candidatePitch}, keyRoot, isMajor);
-        if (!rescored.empty()) {
-            float delta = r.prob - rescored[0].prob; // how much prob drops when removing note
-            // attach to influence matching erased pitch/time
-            for (auto& inf : r.influences) {
-                if (inf.pitch==erased.pitch && std::abs(inf.startSec-erased.startSec)<0.01) {
-                    inf.weight = juce::jlimit(0.0f, 1.0f, inf.weight + delta);
-                    break;
-                }
-            }
-        }
+        requests[(size_t)k] = { ctx, candidates, (int)ctx.size()-1-k };
+    }
+    scoreBatch(requests, keyRoot, isMajor, probs);
+
+    for (int k=0; k<K; ++k) {
+        const auto& erased = ctx[ctx.size()-1-(size_t)k];
+        float delta = r.prob - probs[(size_t)k * candidates.size() + chosen]; // how much prob drops when removing note
+        // attach to influence matching erased pitch/time
+        auto inf = std::find_if(r.influences.begin(), r.influences.end(), [&](const Influence& i) {
+            return i.pitch==erased.pitch && std::abs(i.startSec-erased.startSec)<0.01;
+        });
+        if (inf != r.influences.end())
+            inf->weight = juce::jlimit(0.0f, 1.0f, inf->weight + delta);
+        else if (delta > 0.0f) // older notes the model did not name, but which still mattered
+            r.influences.push_back({ erased.pitch, erased.startSec, erased.endSec, juce::jmin(1.0f, delta) });
     }
     return r;
 }
 
-std::vector<Violation> ExplanationEngine::evaluateRules(const std::vector<ExplanationNotePair>& history,
+void ExplanationEngine::scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                                   std::span<float> probsOut)
+{
+    const int numJobs = ChunkedJobs::jobsFor(pool.get(), requests.size(), minRequestsPerJob);
+    const size_t chunk = (requests.size() + (size_t)numJobs - 1) / (size_t)numJobs;
+
+    ChunkedJobs::runChunked(pool.get(), numJobs, [&](int job)
+    {
+        const size_t first = juce::jmin((size_t)job * chunk, requests.size());
+        const auto part = requests.subspan(first, std::min(chunk, requests.size() - first));
+        const size_t offset = ModelBridge::totalCandidates(requests.first(first));
+        model->scoreBatch(part, keyRoot, isMajor, probsOut.subspan(offset, ModelBridge::totalCandidates(part)));
+    });
+}
+
+std::vector<Violation> ExplanationEngine::evaluateRules(const TimelineView& history,
                                                        int inputPitch, int genPitch, 
                                                        double nowSec, bool inPhrase)
 {
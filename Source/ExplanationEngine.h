@@ -2,25 +2,36 @@
 #include <juce_core/juce_core.h>
 #include "ECCTypes.h"
 #include "RuleChecker.h"
-#include "ModelBridge.h"
+#include "CachingModelBridge.h"
 
 class ExplanationEngine {
 public:
-    ExplanationEngine();
-    // Build rationale for a proposed generated note, given context
-    Rationale explainChoice(const std::vector<ExplanationNotePair>& history,
-                            const std::vector<ContextNote>& context,
+    // Without a model, opens ModelBridge::createDefault() for itself
+    explicit ExplanationEngine(std::shared_ptr<ModelBridge> model = nullptr);
+    // Build rationale for a proposed generated note. history is the phrase before it;
+    // its generated line is the model context.
+    Rationale explainChoice(const TimelineView& history,
                             int inputPitch, int genPitch,
                             int keyRoot, bool isMajor, double nowSec, bool inPhrase);
     
     // Direct rule evaluation for tutor mode
-    std::vector<Violation> evaluateRules(const std::vector<ExplanationNotePair>& history,
+    std::vector<Violation> evaluateRules(const TimelineView& history,
                                         int inputPitch, int genPitch, 
                                         double nowSec, bool inPhrase);
 
+    ModelCacheStats getModelCacheStats() const { return model->getStats(); }
+
+    // How many of the most recent context notes occlusion tests, 0 for all of them
+    void setOcclusionDepth(int numNotes) { occlusionDepth = juce::jmax(0, numNotes); }
+
 private:
     RuleChecker rules;
-    std::unique_ptr<ModelBridge> model;
-    Rationale occlusionExplain(const std::vector<ContextNote>& context,
+    std::unique_ptr<CachingModelBridge> model;   // repeated contexts are common in exercises
+    std::unique_ptr<juce::ThreadPool> pool;      // only if the model is thread-safe and there are cores to spare
+    int occlusionDepth = 5;
+
+    Rationale occlusionExplain(std::span<const ContextNote> context, std::span<const int> candidates,
                                const Rationale& base, int keyRoot, bool isMajor);
+    // model->scoreBatch, split across the pool for large batches
+    void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor, std::span<float> probsOut);
 };
@@ -0,0 +1,355 @@
+#include "InferencePool.h"
+#include <utility>
+
+class InferencePool::Lane : public juce::Thread {
+public:
+    Lane(InferencePool& p, int index)
+        : juce::Thread("Model inference " + juce::String(index)), pool(p)
+    {
+        startThread(juce::Thread::Priority::high);
+    }
+
+    ~Lane() override
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(1000);
+    }
+
+    bool push(const Job& job)
+    {
+        if (!jobs.push(job))
+            return false;
+        wakeUp.signal();
+        return true;
+    }
+
+private:
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            Job job;
+            while (jobs.pop(job))
+                pool.process(job, laneLock);
+
+            wakeUp.wait(100.0);
+        }
+    }
+
+    InferencePool& pool;
+    SpscQueue<Job> jobs { 256 };
+    juce::WaitableEvent wakeUp;
+    juce::CriticalSection laneLock;   // stands in for modelLock when the model needs none
+};
+
+//==============================================================================
+InferencePool::Future::Future(Future&& other) noexcept
+    : pool(std::exchange(other.pool, nullptr)), slot(std::exchange(other.slot, -1))
+{
+}
+
+InferencePool::Future& InferencePool::Future::operator=(Future&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool = std::exchange(other.pool, nullptr);
+        slot = std::exchange(other.slot, -1);
+    }
+    return *this;
+}
+
+bool InferencePool::Future::isReady() const
+{
+    return pool != nullptr && pool->slots[(size_t)slot].state.load(std::memory_order_acquire) == SlotState::Done;
+}
+
+bool InferencePool::Future::waitUntilDeadline() const
+{
+    if (pool == nullptr)
+        return false;
+
+    auto& s = pool->slots[(size_t)slot];
+    while (!isReady())
+    {
+        double waitMs = -1.0;
+        if (s.deadlineTicks != 0)
+        {
+            const juce::int64 left = s.deadlineTicks - juce::Time::getHighResolutionTicks();
+            if (left <= 0)
+                return false;
+            waitMs = juce::Time::highResolutionTicksToSeconds(left) * 1000.0;
+        }
+        s.finished.wait(waitMs);
+    }
+    return true;
+}
+
+juce::int64 InferencePool::Future::getDeadlineTicks() const
+{
+    return pool != nullptr ? pool->slots[(size_t)slot].deadlineTicks : 0;
+}
+
+std::span<const int> InferencePool::Future::getCandidates() const
+{
+    if (pool == nullptr)
+        return {};
+    const auto& s = pool->slots[(size_t)slot];
+    return { s.candidates.data(), (size_t)s.numCandidates };
+}
+
+std::span<const float> InferencePool::Future::getProbabilities() const
+{
+    if (!isReady())
+        return {};
+    const auto& s = pool->slots[(size_t)slot];
+    return { s.probs.data(), (size_t)s.numCandidates };
+}
+
+void InferencePool::Future::release()
+{
+    if (pool != nullptr)
+        pool->releaseSlot(slot);
+    pool = nullptr;
+    slot = -1;
+}
+
+//==============================================================================
+InferencePool::InferencePool(ModelBridge& m, int numLanes)
+    : model(m), serialiseModel(!m.isThreadSafe() && numLanes > 1)
+{
+    for (int i = 0; i < juce::jmax(1, numLanes); ++i)
+        lanes.push_back(std::make_unique<Lane>(*this, i));
+}
+
+InferencePool::~InferencePool()
+{
+    // Stop the threads before the sessions and slots they use go away
+    lanes.clear();
+}
+
+bool InferencePool::submit(int lane, const Job& job)
+{
+    if (lanes[(size_t)lane]->push(job))
+        return true;
+
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+int InferencePool::openSession(int keyRoot, bool isMajor)
+{
+    if (numSessions == maxSessions)
+        return -1;
+
+    const int session = numSessions;
+    Job job;
+    job.type = Job::Type::Open;
+    job.session = session;
+    job.keyRoot = keyRoot;
+    job.isMajor = isMajor;
+    if (!submit(session % (int)lanes.size(), job))
+        return -1;
+
+    ++numSessions;
+    return session;
+}
+
+bool InferencePool::resetSession(int session, int keyRoot, bool isMajor)
+{
+    jassert(session >= 0 && session < numSessions);
+    Job job;
+    job.type = Job::Type::Open;
+    job.session = session;
+    job.keyRoot = keyRoot;
+    job.isMajor = isMajor;
+    return submit(session % (int)lanes.size(), job);
+}
+
+bool InferencePool::append(int session, const ContextNote& note)
+{
+    jassert(session >= 0 && session < numSessions);
+    Job job;
+    job.type = Job::Type::Append;
+    job.session = session;
+    job.note = note;
+    return submit(session % (int)lanes.size(), job);
+}
+
+bool InferencePool::rollback(int session, int numNotes)
+{
+    jassert(session >= 0 && session < numSessions);
+    Job job;
+    job.type = Job::Type::Rollback;
+    job.session = session;
+    job.count = numNotes;
+    return submit(session % (int)lanes.size(), job);
+}
+
+int InferencePool::acquireSlot(std::span<const int> candidatePitches, juce::int64 deadlineTicks)
+{
+    jassert(candidatePitches.size() <= (size_t)maxCandidates);
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto expected = SlotState::Free;
+        auto& s = slots[(size_t)i];
+        if (s.state.compare_exchange_strong(expected, SlotState::Pending, std::memory_order_acq_rel))
+        {
+            s.finished.reset();
+            s.deadlineTicks = deadlineTicks;
+            s.numCandidates = (int)juce::jmin(candidatePitches.size(), (size_t)maxCandidates);
+            std::copy_n(candidatePitches.begin(), s.numCandidates, s.candidates.begin());
+            s.contextSize = 0;
+            return i;
+        }
+    }
+
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+}
+
+InferencePool::Future InferencePool::score(int session, std::span<const int> candidatePitches,
+                                           juce::int64 deadlineTicks)
+{
+    jassert(session >= 0 && session < numSessions);
+    const int slot = acquireSlot(candidatePitches, deadlineTicks);
+    if (slot < 0)
+        return {};
+
+    Job job;
+    job.type = Job::Type::ScoreSession;
+    job.session = session;
+    job.slot = slot;
+    if (!submit(session % (int)lanes.size(), job))
+    {
+        slots[(size_t)slot].state.store(SlotState::Free, std::memory_order_release);
+        return {};
+    }
+    return { this, slot };
+}
+
+InferencePool::Future InferencePool::scoreEach(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                               int keyRoot, bool isMajor, juce::int64 deadlineTicks)
+{
+    const int slot = acquireSlot(candidatePitches, deadlineTicks);
+    if (slot < 0)
+        return {};
+
+    // Only the tail of the context matters to a stateless call
+    auto& s = slots[(size_t)slot];
+    const size_t used = juce::jmin(context.size(), (size_t)maxContext);
+    std::copy(context.end() - (std::ptrdiff_t)used, context.end(), s.context.begin());
+    s.contextSize = (int)used;
+    s.keyRoot = keyRoot;
+    s.isMajor = isMajor;
+
+    Job job;
+    job.type = Job::Type::ScoreEach;
+    job.slot = slot;
+    const int lane = nextStatelessLane;
+    nextStatelessLane = (nextStatelessLane + 1) % (int)lanes.size();
+    if (!submit(lane, job))
+    {
+        s.state.store(SlotState::Free, std::memory_order_release);
+        return {};
+    }
+    return { this, slot };
+}
+
+void InferencePool::process(const Job& job, juce::CriticalSection& laneLock)
+{
+    const juce::ScopedLock sl(serialiseModel ? modelLock : laneLock);
+    ModelSession* session = job.session >= 0 ? sessions[(size_t)job.session].get() : nullptr;
+
+    switch (job.type)
+    {
+        case Job::Type::Open:
+            sessions[(size_t)job.session] = model.createSession(job.keyRoot, job.isMajor);
+            break;
+
+        // A session whose Open job was dropped has nothing to update
+        case Job::Type::Append:
+            if (session != nullptr)
+                session->append(job.note);
+            break;
+
+        case Job::Type::Rollback:
+            if (session != nullptr)
+                session->rollback(job.count);
+            break;
+
+        case Job::Type::ScoreSession:
+        case Job::Type::ScoreEach:
+        {
+            auto& s = slots[(size_t)job.slot];
+
+            // Given up on before it started: not worth running
+            auto expected = SlotState::Abandoned;
+            if (s.state.compare_exchange_strong(expected, SlotState::Free, std::memory_order_acq_rel))
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            const std::span<const int> candidates { s.candidates.data(), (size_t)s.numCandidates };
+            if (job.type == Job::Type::ScoreSession)
+            {
+                if (session != nullptr)
+                    session->score(candidates, { s.probs.data(), candidates.size() });
+                else
+                    std::fill(s.probs.begin(), s.probs.begin() + s.numCandidates, 1.0f / (float)juce::jmax(1, s.numCandidates));
+            }
+            else
+            {
+                std::array<ScoreRequest, maxCandidates> requests;
+                const std::span<const ContextNote> context { s.context.data(), (size_t)s.contextSize };
+                for (size_t i = 0; i < candidates.size(); ++i)
+                    requests[i] = { context, candidates.subspan(i, 1) };
+                model.scoreBatch({ requests.data(), candidates.size() }, s.keyRoot, s.isMajor,
+                                 { s.probs.data(), candidates.size() });
+            }
+
+            finish(job.slot);
+            break;
+        }
+    }
+}
+
+void InferencePool::finish(int slot)
+{
+    auto& s = slots[(size_t)slot];
+    const bool inTime = s.deadlineTicks == 0 || juce::Time::getHighResolutionTicks() <= s.deadlineTicks;
+    (inTime ? onTime : late).fetch_add(1, std::memory_order_relaxed);
+
+    auto expected = SlotState::Pending;
+    if (s.state.compare_exchange_strong(expected, SlotState::Done, std::memory_order_acq_rel))
+        s.finished.signal();
+    else
+        s.state.store(SlotState::Free, std::memory_order_release);   // released while running
+}
+
+void InferencePool::releaseSlot(int slot)
+{
+    auto& s = slots[(size_t)slot];
+    auto expected = SlotState::Pending;
+    if (!s.state.compare_exchange_strong(expected, SlotState::Abandoned, std::memory_order_acq_rel))
+        s.state.store(SlotState::Free, std::memory_order_release);   // was Done
+}
+
+InferenceStats InferencePool::getStats() const
+{
+    InferenceStats s;
+    s.onTime = onTime.load();
+    s.late = late.load();
+    s.dropped = dropped.load();
+    return s;
+}
+
+void InferencePool::resetStats()
+{
+    onTime = 0;
+    late = 0;
+    dropped = 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include "ModelBridge.h"
+#include "SpscQueue.h"
+
+struct InferenceStats
+{
+    juce::uint64 onTime = 0;     // finished by their deadline
+    juce::uint64 late = 0;       // finished after it; the caller had already moved on
+    juce::uint64 dropped = 0;    // never ran: no free slot, lane queue full, or released first
+};
+
+// Runs ModelBridge scoring on dedicated threads so a slow model can never hold up a
+// note. Work is split into lanes, one thread each, fed by a single-producer queue.
+// A session lives on one lane, so its appends and scores run in order on that thread
+// without locks. Lanes run in parallel, or take turns on one lock if the model is not
+// thread-safe.
+//
+// Score requests return a Future that carries its deadline. Requests and results live
+// in a fixed table of slots, so submitting and waiting never allocate.
+// Submit from one thread only (the engine's worker).
+class InferencePool {
+public:
+    static constexpr int maxCandidates = 32;
+    static constexpr int maxContext = 32;
+    static constexpr int numSlots = 16;
+    static constexpr int maxSessions = 8;
+
+    // Handle to one score request. Move-only; releasing (or destroying) it gives the
+    // slot back, and a request still queued or running is then finished into nothing.
+    class Future {
+    public:
+        Future() = default;
+        Future(Future&& other) noexcept;
+        Future& operator=(Future&& other) noexcept;
+        ~Future() { release(); }
+
+        bool isValid() const { return pool != nullptr; }
+        bool isReady() const;
+        // Blocks until the result arrives or the deadline passes; true if the result is in
+        bool waitUntilDeadline() const;
+        juce::int64 getDeadlineTicks() const;
+
+        std::span<const int> getCandidates() const;
+        std::span<const float> getProbabilities() const;   // only once isReady()
+
+        void release();
+
+    private:
+        friend class InferencePool;
+        Future(InferencePool* p, int s) : pool(p), slot(s) {}
+
+        InferencePool* pool = nullptr;
+        int slot = -1;
+    };
+
+    InferencePool(ModelBridge& model, int numLanes);
+    ~InferencePool();
+
+    // Session ids are usable as soon as they are returned; -1 if maxSessions are open.
+    // All of these return false (and count a drop) if the lane's queue is full.
+    int openSession(int keyRoot, bool isMajor);
+    bool resetSession(int session, int keyRoot, bool isMajor);   // also changes key
+    bool append(int session, const ContextNote& note);
+    bool rollback(int session, int numNotes);
+
+    // Candidates scored against each other from the session's state. deadlineTicks is a
+    // juce::Time high-resolution tick count, 0 for none. Invalid if dropped.
+    Future score(int session, std::span<const int> candidatePitches, juce::int64 deadlineTicks);
+
+    // Stateless: each candidate scored on its own after the context
+    Future scoreEach(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                     int keyRoot, bool isMajor, juce::int64 deadlineTicks);
+
+    InferenceStats getStats() const;
+    void resetStats();
+
+private:
+    enum class SlotState { Free, Pending, Done, Abandoned };
+
+    struct Slot
+    {
+        std::atomic<SlotState> state { SlotState::Free };
+        juce::WaitableEvent finished;
+        juce::int64 deadlineTicks = 0;
+        std::array<int, maxCandidates> candidates {};
+        std::array<float, maxCandidates> probs {};
+        std::array<ContextNote, maxContext> context {};
+        int numCandidates = 0, contextSize = 0;
+        int keyRoot = 0;
+        bool isMajor = true;
+    };
+
+    struct Job
+    {
+        enum class Type { Open, Append, Rollback, ScoreSession, ScoreEach };
+
+        Type type = Type::Append;
+        int session = -1;
+        int slot = -1;
+        ContextNote note {};
+        int count = 0;
+        int keyRoot = 0;
+        bool isMajor = true;
+    };
+
+    class Lane;
+
+    int acquireSlot(std::span<const int> candidatePitches, juce::int64 deadlineTicks);
+    bool submit(int lane, const Job& job);
+    void process(const Job& job, juce::CriticalSection& laneLock);
+    void finish(int slot);
+    void releaseSlot(int slot);
+
+    ModelBridge& model;
+    const bool serialiseModel;
+    juce::CriticalSection modelLock;
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    std::array<Slot, numSlots> slots;
+    std::array<std::unique_ptr<ModelSession>, maxSessions> sessions;   // touched by their lane only
+    int numSessions = 0;
+    int nextStatelessLane = 0;
+
+    std::atomic<juce::uint64> onTime { 0 }, late { 0 }, dropped { 0 };
+};
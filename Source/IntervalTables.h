@@ -0,0 +1,129 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Compile-time lookup tables for interval classification and two-voice motion checks.
+// Shared by RuleChecker and the generator so neither redoes abs/%12 arithmetic per candidate.
+namespace IntervalTables
+{
+    enum IntervalFlag : uint8_t
+    {
+        Consonant = 1 << 0,
+        Perfect   = 1 << 1,   // unison/octave or fifth (compound included)
+        Tritone   = 1 << 2,
+        Octave    = 1 << 3,   // interval class 0
+        Fifth     = 1 << 4,   // interval class 7
+        Dissonant = 1 << 5
+    };
+
+    enum MotionViolation : uint8_t
+    {
+        ParallelFifth  = 1 << 0,
+        ParallelOctave = 1 << 1,
+        HiddenPerfect  = 1 << 2   // similar motion into a perfect interval
+    };
+
+    constexpr int maxDiff = 127;
+    constexpr int numDiffs = 2 * maxDiff + 1;
+
+    constexpr int classOf(int semitones)
+    {
+        int s = semitones < 0 ? -semitones : semitones;
+        return s % 12;
+    }
+
+    constexpr uint8_t flagsForClass(int c)
+    {
+        uint8_t f = 0;
+        if (c == 0 || c == 3 || c == 4 || c == 7 || c == 8 || c == 9) f |= Consonant;
+        else f |= Dissonant;
+        if (c == 0 || c == 7) f |= Perfect;
+        if (c == 0) f |= Octave;
+        if (c == 7) f |= Fifth;
+        if (c == 6) f |= Tritone;
+        return f;
+    }
+
+    // Flags for every signed semitone difference in [-127, 127]
+    constexpr std::array<uint8_t, numDiffs> intervalFlagTable = [] {
+        std::array<uint8_t, numDiffs> t {};
+        for (int d = -maxDiff; d <= maxDiff; ++d)
+            t[(size_t)(d + maxDiff)] = flagsForClass(classOf(d));
+        return t;
+    }();
+
+    constexpr std::array<uint8_t, numDiffs> intervalClassTable = [] {
+        std::array<uint8_t, numDiffs> t {};
+        for (int d = -maxDiff; d <= maxDiff; ++d)
+            t[(size_t)(d + maxDiff)] = (uint8_t)classOf(d);
+        return t;
+    }();
+
+    // diff is a difference of two MIDI notes, so within [-maxDiff, maxDiff]
+    constexpr uint8_t flags(int diff)
+    {
+        jassert(diff >= -maxDiff && diff <= maxDiff);
+        return intervalFlagTable[(size_t)(diff + maxDiff)];
+    }
+
+    constexpr int intervalClass(int diff)
+    {
+        jassert(diff >= -maxDiff && diff <= maxDiff);
+        return intervalClassTable[(size_t)(diff + maxDiff)];
+    }
+
+    constexpr bool isConsonant(int diff)      { return (flags(diff) & Consonant) != 0; }
+    constexpr bool isPerfect(int diff)        { return (flags(diff) & Perfect) != 0; }
+    constexpr bool isTritone(int diff)        { return (flags(diff) & Tritone) != 0; }
+
+    constexpr int motion(int from, int to)    { return (to > from) ? 1 : (to < from ? -1 : 0); }
+
+    // Packed index over (prev interval class, curr interval class, input motion, generated motion)
+    constexpr int motionIndex(int prevClass, int currClass, int motionIn, int motionGen)
+    {
+        return ((prevClass * 12 + currClass) * 3 + (motionIn + 1)) * 3 + (motionGen + 1);
+    }
+
+    constexpr std::array<uint8_t, 12 * 12 * 3 * 3> motionTable = [] {
+        std::array<uint8_t, 12 * 12 * 3 * 3> t {};
+        for (int p = 0; p < 12; ++p)
+            for (int c = 0; c < 12; ++c)
+                for (int mi = -1; mi <= 1; ++mi)
+                    for (int mg = -1; mg <= 1; ++mg)
+                    {
+                        uint8_t v = 0;
+                        const bool prevPerfect = (flagsForClass(p) & Perfect) != 0;
+                        const bool currPerfect = (flagsForClass(c) & Perfect) != 0;
+                        const bool similar = (mi == mg && mi != 0);
+
+                        if (prevPerfect && currPerfect && similar)
+                            v |= (p == 0 && c == 0) ? ParallelOctave : ParallelFifth;
+                        if (!prevPerfect && currPerfect && similar)
+                            v |= HiddenPerfect;
+
+                        t[(size_t)motionIndex(p, c, mi, mg)] = v;
+                    }
+        return t;
+    }();
+
+    // Violations for the move (prevIn, prevGen) -> (inP, genP)
+    constexpr uint8_t motionViolations(int prevIn, int prevGen, int inP, int genP)
+    {
+        return motionTable[(size_t)motionIndex(intervalClass(prevGen - prevIn), intervalClass(genP - inP),
+                                               motion(prevIn, inP), motion(prevGen, genP))];
+    }
+
+    constexpr const char* intervalNames[12] = {
+        "unison", "minor 2nd", "major 2nd", "minor 3rd", "major 3rd", "perfect 4th",
+        "tritone", "perfect 5th", "minor 6th", "major 6th", "minor 7th", "major 7th"
+    };
+
+    constexpr const char* intervalNameFor(int diff) { return intervalNames[intervalClass(diff)]; }
+
+    static_assert(isConsonant(-16) && !isConsonant(6) && isTritone(-18) && isPerfect(19));
+    static_assert(motionViolations(60, 67, 62, 69) == ParallelFifth);
+    static_assert(motionViolations(60, 72, 62, 74) == ParallelOctave);
+    static_assert(motionViolations(60, 64, 62, 69) == HiddenPerfect);
+}
@@ -1,4 +1,6 @@
 #include "MainComponent.h"
+#include "NGramModel.h"
+#include <algorithm>
 #include <cmath>
 
 MainComponent::MainComponent()
@@ -14,14 +16,15 @@ MainComponent::MainComponent()
     juce::LookAndFeel::setDefaultLookAndFeel(customLookAndFeel.get());
     
     midiManager = std::make_unique<MidiManager>();
-    counterpointEngine = std::make_unique<CounterpointEngine>();
+    counterpointEngine = std::make_unique<CounterpointEngine>(model);
     pianoRoll = std::make_unique<PianoRoll>();
     
     if (counterpointEngine)
+    {
         counterpointEngine->setGenerateAbove(isGenerateAbove);
-    
-    if (pianoRoll)
-        pianoRoll->setGenerateAbove(isGenerateAbove);
+        // Without a trained model the model stage would only add the mock's noise
+        counterpointEngine->setModelBlending(counterpointEngine->hasTrainedModel());
+    }
     
     audioDeviceManager.initialise(0, 2, nullptr, true);
     
@@ -45,9 +48,11 @@ MainComponent::MainComponent()
         if (isGeneratorMode) {
             buttonAlphaAnim.setTargetValue(1.0f);
             aboveBelowToggle.setInterceptsMouseClicks(true, false);
+            voiceCountToggle.setInterceptsMouseClicks(true, false);
         } else {
             buttonAlphaAnim.setTargetValue(0.45f);
             aboveBelowToggle.setInterceptsMouseClicks(false, false);
+            voiceCountToggle.setInterceptsMouseClicks(false, false);
         }
         
         aboveBelowToggle.setVisible(true);
@@ -57,6 +62,11 @@ MainComponent::MainComponent()
         if (isGeneratorMode)
             eccPanel.setStatusText("");
         
+        PipelineEvent modeChange;
+        modeChange.type = PipelineEvent::Type::SetGeneratorMode;
+        modeChange.flag = isGeneratorMode;
+        pipeline.pushControl(modeChange);
+        
         repaint();
     };
     addAndMakeVisible(modeToggle);
@@ -69,49 +79,67 @@ MainComponent::MainComponent()
         isDirectionAnimating = true;
         startTimerHz(60);
         
-        if (counterpointEngine)
-            counterpointEngine->setGenerateAbove(isGenerateAbove);
-        
-        if (pianoRoll)
-            pianoRoll->setGenerateAbove(isGenerateAbove);
+        PipelineEvent directionChange;
+        directionChange.type = PipelineEvent::Type::SetGenerateAbove;
+        directionChange.flag = isGenerateAbove;
+        pipeline.pushControl(directionChange);
         
         repaint();
     };
     addAndMakeVisible(aboveBelowToggle);
     
-    // Start in Tutor Mode, so direction button is disabled
+    // Cycles 2 -> 3 -> 4 voices; the input is one of them
+    voiceCountToggle.onClick = [this] {
+        voiceCount = voiceCount == VoiceLeadingSearch::maxVoices ? 2 : voiceCount + 1;
+        voiceCountToggle.setButtonText(juce::String(voiceCount) + " Voices");
+        
+        PipelineEvent voicesChange;
+        voicesChange.type = PipelineEvent::Type::SetVoiceCount;
+        voicesChange.count = voiceCount;
+        pipeline.pushControl(voicesChange);
+    };
+    addAndMakeVisible(voiceCountToggle);
+    
+    // Start in Tutor Mode, so the generator buttons are disabled
     aboveBelowToggle.setAlpha(0.45f);
     aboveBelowToggle.setInterceptsMouseClicks(false, false);
+    voiceCountToggle.setAlpha(0.45f);
+    voiceCountToggle.setInterceptsMouseClicks(false, false);
     
     addAndMakeVisible(resetPhraseButton);
     resetPhraseButton.onClick = [this] {
-        history.clear();
-        ruleHistory.clear();
-        contextNotes.clear();
-        activeNotes.clear();
-        activeNoteMapping.clear();
-        activeGeneratedNotes.clear();
+        PipelineEvent reset;
+        reset.type = PipelineEvent::Type::Reset;
+        pipeline.pushControl(reset);
         inPhrase = false;
         
         if (pianoRoll)
             pianoRoll->clearAllNotes();
         
         eccPanel.setStatusText("");
-        synth.allNotesOff(0, true);
-        synth.allNotesOff(1, true);
     };
     
     eccLog.reset(new JsonlLogger(juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
                                  .getChildFile("counterpoints_ecc_log.jsonl")));
     refreshMidiInputs();
+    
+   #if POLYMUSE_TRACE
+    traceView = std::make_unique<TraceView>(juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                            .getChildFile("counterpoints_trace.bin"));
+    addChildComponent(*traceView);
+   #endif
+    
     startTimer(50);
     addComponentListener(this);
-    
+    pipeline.start();
 }
 
 void MainComponent::mouseDoubleClick(const juce::MouseEvent&)
 {
     // Fullscreen handled by macOS
+   #if POLYMUSE_TRACE
+    traceView->setVisible(!traceView->isVisible());
+   #endif
 }
 
 void MainComponent::handleFullscreenChange()
@@ -161,6 +189,13 @@ MainComponent::~MainComponent()
         } catch (...) {}
     }
     
+    // No more MIDI can arrive, so the worker can go before the engine it drives
+    pipeline.stop();
+    
+   #if POLYMUSE_TRACE
+    traceView.reset();   // writes out the last records
+   #endif
+    
     try {
         shutdownAudio();
     } catch (...) {}
@@ -245,6 +280,7 @@ void MainComponent::resized()
     modeToggle.setBounds(centerX - buttonWidth / 2, midiInputComboBox.getBottom() + spacing, buttonWidth, buttonHeight);
     aboveBelowToggle.setBounds(centerX - buttonWidth / 2, modeToggle.getBottom() + spacing, buttonWidth, buttonHeight);
     resetPhraseButton.setBounds(centerX - buttonWidth / 2, aboveBelowToggle.getBottom() + spacing, buttonWidth, buttonHeight);
+    voiceCountToggle.setBounds(aboveBelowToggle.getRight() + spacing, aboveBelowToggle.getY(), buttonWidth, buttonHeight);
 
     area.removeFromTop(gapAboveAnalysis);
 
@@ -259,6 +295,11 @@ void MainComponent::resized()
         pianoRoll->setBounds(area);
         pianoRoll->updateLayout(area);
     }
+    
+   #if POLYMUSE_TRACE
+    if (traceView)
+        traceView->setBounds(area);
+   #endif
 
     // Adjust piano roll note range based on window height
     int windowHeight = getHeight();
@@ -319,6 +360,7 @@ void MainComponent::timerCallback()
     {
         buttonAlphaAnim.skip(1);
         aboveBelowToggle.setAlpha(buttonAlphaAnim.getCurrentValue());
+        voiceCountToggle.setAlpha(buttonAlphaAnim.getCurrentValue());
         
         if (std::abs(buttonAlphaAnim.getCurrentValue() - buttonAlphaAnim.getTargetValue()) < 0.01f)
             isAnimating = false;
@@ -360,16 +402,19 @@ void MainComponent::timerCallback()
     
     // Auto-stop stuck notes after 5 seconds
     double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
-    if (now - lastNoteOnTime > 5.0)
+    if (now - lastNoteOnTime.load() > 5.0)
     {
-        synth.allNotesOff(1, true);
+        PipelineEvent stop;
+        stop.type = PipelineEvent::Type::StopGenerated;
+        pipeline.pushControl(stop);
         lastNoteOnTime = now;
     }
 }
 
 void MainComponent::handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& msg)
 {
-    processMidiMessage(msg);
+    // MIDI driver thread: enqueue only, everything else happens on the pipeline worker
+    pipeline.pushMidi(msg);
 }
 
 void MainComponent::setupUI()
@@ -424,6 +469,7 @@ void MainComponent::setupButtons()
     setupFlatToggle(modeToggle, "Tutor Mode");
     setupFlatToggle(aboveBelowToggle, "Generate Above");
     setupButton(resetPhraseButton, "Reset Phrase");
+    setupFlatToggle(voiceCountToggle, "2 Voices");
 }
 
 void MainComponent::setupLabels()
@@ -531,156 +577,222 @@ void MainComponent::onMidiInputChanged()
 
 
 
-void MainComponent::processMidiMessage(const juce::MidiMessage& message)
+void MainComponent::processPipelineEvent(const PipelineEvent& event)
 {
-    double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    switch (event.type)
+    {
+        case PipelineEvent::Type::NoteOn:
+            processNoteOn(event.pitch, event.velocity, event.timeSec);
+            break;
+            
+        case PipelineEvent::Type::NoteOff:
+            processNoteOff(event.pitch);
+            break;
+            
+        case PipelineEvent::Type::Reset:
+            tutorRules.reset();
+            activeNotes.clear();
+            if (counterpointEngine)
+                counterpointEngine->resetPhrase();
+            keyHistogram.fill(0.0f);
+            keyNotes = 0;
+            activeNoteMapping.clear();
+            pipeline.pushSynth({ SynthEvent::Type::AllNotesOff, 0 });
+            pipeline.pushSynth({ SynthEvent::Type::AllNotesOff, 1 });
+            break;
+            
+        case PipelineEvent::Type::SetGeneratorMode:
+            eccMode = event.flag ? ECCMode::Generator : ECCMode::Tutor;
+            break;
+            
+        case PipelineEvent::Type::SetGenerateAbove:
+            if (counterpointEngine)
+                counterpointEngine->setGenerateAbove(event.flag);
+            break;
+            
+        case PipelineEvent::Type::SetVoiceCount:
+            if (counterpointEngine)
+                counterpointEngine->setVoiceCount(event.count);
+            break;
+            
+        case PipelineEvent::Type::StopGenerated:
+            pipeline.pushSynth({ SynthEvent::Type::AllNotesOff, 1 });
+            break;
+    }
+}
+
+// Re-estimates the key from the phrase's pitch classes once there are enough of them.
+// The engine re-encodes the model context on a change, so it is only told about changes.
+void MainComponent::followKey(int inPitch)
+{
+    constexpr int minNotes = 6;
+
+    keyHistogram[(size_t)(inPitch % 12)] += 1.0f;
+    if (++keyNotes < minNotes)
+        return;
+
+    int root = 0;
+    bool minor = false;
+    NGram::estimateKey(keyHistogram, root, minor);
+    if (root != keyRoot || minor != keyIsMinor)
+    {
+        keyRoot = root;
+        keyIsMinor = minor;
+        counterpointEngine->setKey(keyRoot, !keyIsMinor);
+    }
+}
+
+void MainComponent::processNoteOn(int inPitch, float vel, double now)
+{
+    lastNoteOnTime = now;
     
-    if (message.isNoteOn())
+    pipeline.pushUi({ UiEvent::Type::NoteOn, 0, inPitch, vel });
+    
+    if (eccMode == ECCMode::Tutor)
     {
-        lastNoteOnTime = now;
-        
-        const int inPitch = message.getNoteNumber();
-        const float vel = message.getVelocity();
+        activeNotes.insert(inPitch);
         
-        if (pianoRoll)
-            pianoRoll->noteOn(0, inPitch, vel);
-        
-        if (eccMode == ECCMode::Tutor)
+        if (activeNotes.size() == 2)
         {
-            activeNotes.insert(inPitch);
-            
-            if (activeNotes.size() == 2)
-            {
-                std::vector<int> notes(activeNotes.begin(), activeNotes.end());
-                int lower = std::min(notes[0], notes[1]);
-                int upper = std::max(notes[0], notes[1]);
+            std::vector<int> notes(activeNotes.begin(), activeNotes.end());
+            int lower = std::min(notes[0], notes[1]);
+            int upper = std::max(notes[0], notes[1]);
+
+            // The streaming checker carries what the rules need from earlier pairs
+            const auto& results = tutorRules.push({ lower, upper, now });
 
-                history.push_back({ lower, upper, now });
-                if (history.size() > 64)
-                    history.pop_front();
+            juce::String msgText = "Current interval: " +
+                                   ruleChecker.intervalName(std::abs(upper - lower) % 12) + "\n";
 
-                std::vector<NotePair> histVec;
-                for (const auto& pair : history)
+            bool hasViolation = false;
+            for (const auto& v : results)
+            {
+                if (v.kind != ViolationKind::Other && v.kind != ViolationKind::Consonance
+                    && v.kind != ViolationKind::FinalSonority)
                 {
-                    histVec.emplace_back(pair.input, pair.gen, pair.timeSec);
+                    hasViolation = true;
+                    break;
                 }
-                auto results = ruleChecker.evaluate(histVec, lower, upper, now);
-
-                juce::String msgText = "Current interval: " +
-                                       ruleChecker.intervalName(std::abs(upper - lower) % 12) + "\n";
+            }
 
-                bool hasViolation = false;
+            juce::String fullText = "";
+            
+            if (hasViolation)
+            {
+                juce::String violationType = "", suggestion = "";
                 for (const auto& v : results)
                 {
-                    if (v.kind != ViolationKind::Other && v.kind != ViolationKind::Consonance)
+                    if (v.kind != ViolationKind::Consonance)
                     {
-                        hasViolation = true;
+                        violationType = RuleChecker::kindName(v.kind);
+                        suggestion = RuleChecker::suggest(v);
                         break;
                     }
                 }
-
-                juce::String fullText = "";
                 
-                if (hasViolation)
-                {
-                    juce::String violationType = "";
-                    for (const auto& v : results)
-                    {
-                        if (v.kind != ViolationKind::Consonance)
-                        {
-                            switch (v.kind)
-                            {
-                                case ViolationKind::ParallelFifth:
-                                    violationType = "Parallel 5th";
-                                    break;
-                                case ViolationKind::ParallelOctave:
-                                    violationType = "Parallel octave";
-                                    break;
-                                case ViolationKind::DissonanceOnStrongBeat:
-                                    violationType = "Dissonance";
-                                    break;
-                                case ViolationKind::HiddenFifthOctave:
-                                    violationType = "Hidden fifth/octave";
-                                    break;
-                                case ViolationKind::VoiceCrossing:
-                                    violationType = "Voice crossing";
-                                    break;
-                                case ViolationKind::LargeLeap:
-                                    violationType = "Large leap";
-                                    break;
-                                case ViolationKind::DirectMotionToPerfect:
-                                    violationType = "Direct motion to perfect interval";
-                                    break;
-                                case ViolationKind::RangeExceeded:
-                                    violationType = "Range exceeded";
-                                    break;
-                                default:
-                                    violationType = "Rule violation";
-                            break;
-                            }
-                            break;
-                        }
-                    }
-                    
-                    fullText = "Violations detected: " + violationType + "\n" + msgText;
-                }
-                else
-                {
-                    fullText = msgText;
-                }
-                    
-                updateAnalysisText(fullText, hasViolation);
+                fullText = "Violations detected: " + violationType + "\n" + msgText;
+                if (suggestion.isNotEmpty())
+                    fullText += suggestion + "\n";
+            }
+            else
+            {
+                fullText = msgText;
             }
-        }
-        else if (eccMode == ECCMode::Generator && counterpointEngine)
-        {
-            auto gen = counterpointEngine->generateCounterpoint(message);
-            int generatedPitch = gen.getNoteNumber();
-            
-            history.push_back({ inPitch, generatedPitch, now });
-            if (history.size() > 64)
-                history.pop_front();
-            
-            activeNoteMapping[inPitch] = generatedPitch;
-            activeGeneratedNotes[inPitch] = generatedPitch;
-            
-            int interval = std::abs(generatedPitch - inPitch) % 12;
-            updateAnalysisText("Current interval: " + ruleChecker.intervalName(interval), false);
-            
-            if (pianoRoll)
-                pianoRoll->noteOn(1, gen.getNoteNumber(), vel);
             
-            synth.noteOn(1, gen.getNoteNumber(), (juce::uint8)120);
+            UiEvent analysis;
+            analysis.type = UiEvent::Type::Analysis;
+            analysis.text = fullText;
+            analysis.violation = hasViolation;
+            pipeline.pushUi(analysis);
         }
-        
-        synth.noteOn(0, inPitch, vel);
     }
-    else if (message.isNoteOff())
+    else if (eccMode == ECCMode::Generator && counterpointEngine)
     {
-        int inputPitch = message.getNoteNumber();
+        followKey(inPitch);
+        const auto voices = counterpointEngine->generateVoices(juce::MidiMessage::noteOn(1, inPitch, (juce::uint8)vel),
+                                                               noteBudgetMicros);
+        
+        // The outer generated voice is the one the explanation and the two-voice rules follow
+        const bool above = counterpointEngine->getGenerateAbove();
+        int generatedPitch = voices.front().getNoteNumber();
+        for (const auto& v : voices)
+            generatedPitch = above ? juce::jmax(generatedPitch, v.getNoteNumber()) : juce::jmin(generatedPitch, v.getNoteNumber());
+        
+        activeNoteMapping[inPitch] = generatedPitch;
+        
+        int interval = std::abs(generatedPitch - inPitch) % 12;
+        UiEvent analysis;
+        analysis.type = UiEvent::Type::Analysis;
+        analysis.text = "Current interval: " + ruleChecker.intervalName(interval);
+
+        // Model scores that missed their note only annotate the explanation
+        LateModelResult late;
+        if (counterpointEngine->takeLateModelResult(late))
+            analysis.text << "\nModel (late) for " << juce::MidiMessage::getMidiNoteName(late.inputPitch, true, true, 4)
+                          << ": preferred " << juce::MidiMessage::getMidiNoteName(late.preferredPitch, true, true, 4)
+                          << " (p " << juce::String(late.preferredProb, 2) << ") over "
+                          << juce::MidiMessage::getMidiNoteName(late.generatedPitch, true, true, 4);
+        pipeline.pushUi(analysis);
         
-        if (eccMode == ECCMode::Tutor)
+        // Crossing is a rule like any other; the piano roll only shows the checker's verdict
+        PairContext order;
+        order.voiceOrder = above ? 1 : -1;
+        for (const auto& v : voices)
         {
-            activeNotes.erase(inputPitch);
-            pianoRoll->noteOff(0, inputPitch);
+            const int pitch = v.getNoteNumber();
+            Violation found[RuleChecker::maxPairViolations];
+            const int numFound = ruleChecker.evaluatePair(nullptr, { inPitch, pitch, now }, order, found);
+
+            UiEvent generated { UiEvent::Type::NoteOn, 1, pitch, vel };
+            generated.crossing = std::any_of(found, found + numFound,
+                                             [](const Violation& f) { return f.kind == ViolationKind::VoiceCrossing; });
+            pipeline.pushUi(generated);
+            pipeline.pushSynth({ SynthEvent::Type::NoteOn, 1, pitch, 120.0f });
         }
-        else if (eccMode == ECCMode::Generator)
+    }
+    
+    pipeline.pushSynth({ SynthEvent::Type::NoteOn, 0, inPitch, vel });
+}
+
+void MainComponent::processNoteOff(int inputPitch)
+{
+    pipeline.pushUi({ UiEvent::Type::NoteOff, 0, inputPitch });
+    
+    if (eccMode == ECCMode::Tutor)
+    {
+        activeNotes.erase(inputPitch);
+    }
+    else if (eccMode == ECCMode::Generator && counterpointEngine)
+    {
+        // The engine remembers what it played for each held input, one note or a whole voicing
+        for (const auto& off : counterpointEngine->noteOffsForInput(inputPitch))
         {
-            pianoRoll->noteOff(0, inputPitch);
-            
-            auto it = activeGeneratedNotes.find(inputPitch);
-            if (it != activeGeneratedNotes.end())
-            {
-                int genNote = it->second;
-                pianoRoll->noteOff(1, genNote);
-                synth.noteOff(1, genNote, 0.0f, false);
-                activeGeneratedNotes.erase(it);
-            }
+            pipeline.pushUi({ UiEvent::Type::NoteOff, 1, off.getNoteNumber() });
+            pipeline.pushSynth({ SynthEvent::Type::NoteOff, 1, off.getNoteNumber() });
         }
-        
-        synth.noteOff(0, message.getNoteNumber(), 0.0f, false);
     }
     
+    pipeline.pushSynth({ SynthEvent::Type::NoteOff, 0, inputPitch });
+}
+
+void MainComponent::handlePipelineUiEvent(const UiEvent& event)
+{
+    switch (event.type)
+    {
+        case UiEvent::Type::NoteOn:
+            if (pianoRoll)
+                pianoRoll->noteOn(event.voice, event.pitch, event.velocity, event.crossing);
+            break;
+            
+        case UiEvent::Type::NoteOff:
+            if (pianoRoll)
+                pianoRoll->noteOff(event.voice, event.pitch);
+            break;
+            
+        case UiEvent::Type::Analysis:
+            updateAnalysisText(event.text, event.violation);
+            break;
+    }
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
@@ -703,6 +815,9 @@ void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& buffer
     juce::MidiBuffer midiBuffer;
     bufferToFill.buffer->clear();
     
+    // Note events produced by the pipeline worker since the last block
+    pipeline.applySynthEvents(synth);
+    
     if (synth.getNumVoices() > 0)
     {
         try {
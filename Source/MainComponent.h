@@ -4,10 +4,11 @@
 #include <juce_gui_extra/juce_gui_extra.h>
 #include <juce_audio_utils/juce_audio_utils.h>
 #include <juce_audio_devices/juce_audio_devices.h>
-#include <deque>
+#include <array>
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <atomic>
 #include "MidiManager.h"
 #include "CounterpointEngine.h"
 #include "PianoRoll.h"
@@ -17,6 +18,10 @@
 #include "ModelBridge.h"
 #include "Logger.h"
 #include "RuleChecker.h"
+#include "StreamingRuleChecker.h"
+#include "MidiPipeline.h"
+#include "TraceRing.h"
+#include "TraceView.h"
 
 // Removes focus outlines from buttons
 class PolyMuseLookAndFeel : public juce::LookAndFeel_V4
@@ -109,7 +114,8 @@ private:
 class MainComponent : public juce::AudioAppComponent,
                       public juce::MidiInputCallback,
                       public juce::Timer,
-                      public juce::ComponentListener
+                      public juce::ComponentListener,
+                      private MidiPipeline::Listener
 {
 public:
     enum class ECCMode { Tutor, Generator };
@@ -128,6 +134,7 @@ public:
     void releaseResources() override;
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
     
+    PipelineStats getPipelineStats() const { return pipeline.getStats(); }
 
 private:
     // UI
@@ -140,36 +147,51 @@ private:
     AnimatedButton aboveBelowToggle;
     
     // Core components
+    // One model for generation and explanations, so the model server is probed once
+    std::shared_ptr<ModelBridge> model { ModelBridge::share(ModelBridge::createDefault()) };
     std::unique_ptr<MidiManager> midiManager;
     std::unique_ptr<CounterpointEngine> counterpointEngine;
     std::unique_ptr<PianoRoll> pianoRoll;
     
     // Explanation engine
-    ExplanationEngine ecc;
+    ExplanationEngine ecc { model };
     ECCPanel eccPanel;
-    std::deque<ExplanationNotePair> history;
-    std::deque<ContextNote> contextNotes;
-    std::map<int, int> activeNoteMapping;
-    const int contextMax = 32;
     std::unique_ptr<JsonlLogger> eccLog;
     
-    // Rule checking
+    // Worker-thread state: only touched from processPipelineEvent. The phrase itself
+    // lives in counterpointEngine's timeline; tutorRules keeps what the tutor needs.
+    std::map<int, int> activeNoteMapping;
     RuleChecker ruleChecker;
-    std::deque<NotePair> ruleHistory;
+    StreamingRuleChecker tutorRules;
+    static constexpr int noteBudgetMicros = 3000;   // per generated note; later stages are skipped past it
+    std::set<int> activeNotes;
+    ECCMode eccMode = ECCMode::Tutor;
+    // Pitch classes played this phrase; the engine follows the key they suggest
+    std::array<float, 12> keyHistogram {};
+    int keyNotes = 0;
+    int keyRoot = 0;
+    bool keyIsMinor = false;
     
     // Audio
     juce::AudioDeviceManager audioDeviceManager;
     juce::Synthesiser synth;
-    std::unordered_map<int, int> activeGeneratedNotes;
+    
+    // MIDI thread -> worker -> audio / message thread
+    MidiPipeline pipeline { *this };
+    
+   #if POLYMUSE_TRACE
+    // Drains the engine trace while running; double-click the window to show it
+    std::unique_ptr<TraceView> traceView;
+   #endif
     
     // State
     juce::String currentStatus;
-    double lastNoteOnTime = 0.0;
-    ECCMode eccMode = ECCMode::Tutor;
+    std::atomic<double> lastNoteOnTime { 0.0 };
     bool isGeneratorMode = false;
     bool isGenerateAbove = true;
-    std::set<int> activeNotes;
     AnimatedButton resetPhraseButton{"Reset Phrase"};
+    AnimatedButton voiceCountToggle{"2 Voices"};
+    int voiceCount = 2;
     bool inPhrase = false;
     
     // Visual effects
@@ -198,7 +220,11 @@ private:
     void enableMidiInput(bool enable);
     void onMidiInputChanged();
     bool shouldGenerateAbove() const { return isGenerateAbove; }
-    void processMidiMessage(const juce::MidiMessage& message);
+    void processPipelineEvent(const PipelineEvent& event) override;
+    void handlePipelineUiEvent(const UiEvent& event) override;
+    void processNoteOn(int inPitch, float vel, double now);
+    void processNoteOff(int inputPitch);
+    void followKey(int inPitch);
     
     // UI updates
     void updateAnalysisText(const juce::String& message, bool violation);
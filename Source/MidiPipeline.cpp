@@ -0,0 +1,126 @@
+#include "MidiPipeline.h"
+
+MidiPipeline::MidiPipeline(Listener& l)
+    : juce::Thread("MIDI pipeline worker"), listener(l)
+{
+}
+
+MidiPipeline::~MidiPipeline()
+{
+    stop();
+}
+
+void MidiPipeline::start()
+{
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::high);
+}
+
+void MidiPipeline::stop()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(1000);
+    cancelPendingUpdate();
+}
+
+bool MidiPipeline::pushMidi(const juce::MidiMessage& message)
+{
+    PipelineEvent event;
+
+    if (message.isNoteOn())
+        event.type = PipelineEvent::Type::NoteOn;
+    else if (message.isNoteOff())
+        event.type = PipelineEvent::Type::NoteOff;
+    else
+        return true;   // nothing downstream cares about other messages
+
+    event.pitch = message.getNoteNumber();
+    event.velocity = message.getVelocity();
+    event.timeSec = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+    // No notify() here: it takes a lock, so the worker polls instead
+    return midiQueue.push(event);
+}
+
+bool MidiPipeline::pushControl(const PipelineEvent& event)
+{
+    const bool ok = controlQueue.push(event);
+    notify();
+    return ok;
+}
+
+bool MidiPipeline::pushSynth(const SynthEvent& event)
+{
+    return synthQueue.push(event);
+}
+
+bool MidiPipeline::pushUi(const UiEvent& event)
+{
+    const bool ok = uiQueue.push(event);
+    triggerAsyncUpdate();
+    return ok;
+}
+
+void MidiPipeline::applySynthEvents(juce::Synthesiser& synth)
+{
+    SynthEvent event;
+    while (synthQueue.pop(event))
+    {
+        switch (event.type)
+        {
+            case SynthEvent::Type::NoteOn:
+                synth.noteOn(event.channel, event.pitch, event.velocity);
+                break;
+            case SynthEvent::Type::NoteOff:
+                synth.noteOff(event.channel, event.pitch, 0.0f, false);
+                break;
+            case SynthEvent::Type::AllNotesOff:
+                synth.allNotesOff(event.channel, true);
+                break;
+        }
+    }
+}
+
+PipelineStats MidiPipeline::getStats() const
+{
+    PipelineStats s;
+    s.midiIn = midiQueue.getStats();
+    s.control = controlQueue.getStats();
+    s.audio = synthQueue.getStats();
+    s.ui = uiQueue.getStats();
+    return s;
+}
+
+void MidiPipeline::run()
+{
+    PipelineEvent event;
+
+    while (!threadShouldExit())
+    {
+        bool didWork = false;
+
+        // Commands are rare and cheap; handle them before the next batch of notes
+        while (controlQueue.pop(event))
+        {
+            listener.processPipelineEvent(event);
+            didWork = true;
+        }
+
+        while (midiQueue.pop(event))
+        {
+            listener.processPipelineEvent(event);
+            didWork = true;
+        }
+
+        if (!didWork)
+            wait(1);
+    }
+}
+
+void MidiPipeline::handleAsyncUpdate()
+{
+    UiEvent event;
+    while (uiQueue.pop(event))
+        listener.handlePipelineUiEvent(event);
+}
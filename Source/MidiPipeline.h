@@ -0,0 +1,106 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <vector>
+#include "SpscQueue.h"
+
+// Input to the worker: a note from the MIDI thread or a command from the message thread
+struct PipelineEvent
+{
+    enum class Type : juce::uint8 { NoteOn, NoteOff, Reset, SetGeneratorMode, SetGenerateAbove, SetVoiceCount, StopGenerated };
+
+    Type type = Type::NoteOn;
+    int pitch = 0;
+    float velocity = 0.0f;
+    bool flag = false;       // payload for the Set* commands
+    int count = 0;           // payload for SetVoiceCount
+    double timeSec = 0.0;    // arrival time on the MIDI thread
+};
+
+// Worker -> audio thread
+struct SynthEvent
+{
+    enum class Type : juce::uint8 { NoteOn, NoteOff, AllNotesOff };
+
+    Type type = Type::NoteOn;
+    int channel = 0;
+    int pitch = 0;
+    float velocity = 0.0f;
+};
+
+// Worker -> message thread
+struct UiEvent
+{
+    enum class Type : juce::uint8 { NoteOn, NoteOff, Analysis };
+
+    Type type = Type::NoteOn;
+    int voice = 0;
+    int pitch = 0;
+    float velocity = 0.0f;
+    juce::String text;       // Analysis only
+    bool violation = false;  // Analysis only
+    bool crossing = false;   // NoteOn of a generated note the rule checker found crossing the input
+};
+
+struct PipelineStats
+{
+    QueueStats midiIn;    // MIDI thread -> worker
+    QueueStats control;   // message thread -> worker
+    QueueStats audio;     // worker -> audio thread
+    QueueStats ui;        // worker -> message thread
+};
+
+// Staged MIDI processing. The MIDI callback only timestamps and enqueues;
+// generation and rule checking run on a worker thread, whose results reach the
+// audio thread and the message thread through their own queues.
+class MidiPipeline : private juce::Thread,
+                     private juce::AsyncUpdater
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        // Worker thread: do the heavy work and push results with pushSynth / pushUi
+        virtual void processPipelineEvent(const PipelineEvent& event) = 0;
+
+        // Message thread: apply a result to the UI
+        virtual void handlePipelineUiEvent(const UiEvent& event) = 0;
+    };
+
+    explicit MidiPipeline(Listener& listener);
+    ~MidiPipeline() override;
+
+    void start();
+    void stop();
+
+    // MIDI thread. Never blocks; returns false if the event had to be dropped.
+    bool pushMidi(const juce::MidiMessage& message);
+
+    // Message thread
+    bool pushControl(const PipelineEvent& event);
+
+    // Worker thread
+    bool pushSynth(const SynthEvent& event);
+    bool pushUi(const UiEvent& event);
+
+    // Audio thread: apply pending note events before rendering the block
+    void applySynthEvents(juce::Synthesiser& synth);
+
+    PipelineStats getStats() const;
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    Listener& listener;
+    SpscQueue<PipelineEvent> midiQueue { 1024 };
+    SpscQueue<PipelineEvent> controlQueue { 64 };
+    SpscQueue<SynthEvent> synthQueue { 1024 };
+    SpscQueue<UiEvent> uiQueue { 1024 };
+
+    JUCE_DECLARE_NON_COPYABLE(MidiPipeline)
+};
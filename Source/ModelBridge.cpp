@@ -0,0 +1,85 @@
+#include "ModelBridge.h"
+#include "RemoteModel.h"
+
+namespace
+{
+    // Still reports the inner model as not thread-safe, so no caller fans work out to
+    // it that would only queue on the lock
+    class SerialisedModelBridge : public ModelBridge {
+    public:
+        explicit SerialisedModelBridge(std::unique_ptr<ModelBridge> m) : inner(std::move(m)) {}
+
+        std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& context,
+                                               const std::vector<int>& candidatePitches,
+                                               int keyRoot, bool isMajor) override
+        {
+            const juce::ScopedLock sl(lock);
+            return inner->scoreCandidates(context, candidatePitches, keyRoot, isMajor);
+        }
+
+        void scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                int keyRoot, bool isMajor, std::span<float> probsOut) override
+        {
+            const juce::ScopedLock sl(lock);
+            inner->scoreProbabilities(context, candidatePitches, keyRoot, isMajor, probsOut);
+        }
+
+        void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                        std::span<float> probsOut) override
+        {
+            const juce::ScopedLock sl(lock);
+            inner->scoreBatch(requests, keyRoot, isMajor, probsOut);
+        }
+
+        // A backend's own session keeps its own state and goes straight to it; the default
+        // one re-scores through scoreProbabilities, so it is rebuilt on top of the lock
+        std::unique_ptr<ModelSession> createSession(int keyRoot, bool isMajor) override
+        {
+            auto session = inner->createSession(keyRoot, isMajor);
+            if (dynamic_cast<WindowedModelSession*>(session.get()) != nullptr)
+                return std::make_unique<WindowedModelSession>(*this, keyRoot, isMajor);
+            return session;
+        }
+
+        int contextWindow() const override { return inner->contextWindow(); }
+        bool isThreadSafe() const override { return false; }
+        bool isTrained() const override { return inner->isTrained(); }
+
+    private:
+        std::unique_ptr<ModelBridge> inner;
+        juce::CriticalSection lock;
+    };
+}
+
+juce::File ModelBridge::getDefaultModelFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("PolyMuse").getChildFile("polymuse.ngram");
+}
+
+juce::File ModelBridge::getDefaultNeuralModelFile()
+{
+    return getDefaultModelFile().getSiblingFile("polymuse.gru");
+}
+
+std::unique_ptr<ModelBridge> ModelBridge::createDefault()
+{
+    // A running PolyMuseModelServer wins over anything loaded in process
+    const auto socketPath = RemoteModelProtocol::getDefaultSocketPath();
+    if (socketPath.isNotEmpty() && juce::File(socketPath).exists())
+        if (auto remote = createRemote(socketPath))
+            return remote;
+
+    if (auto neural = createNeural(getDefaultNeuralModelFile()))
+        return neural;
+    if (auto ngram = createNGram(getDefaultModelFile()))
+        return ngram;
+    return createMock();
+}
+
+std::shared_ptr<ModelBridge> ModelBridge::share(std::unique_ptr<ModelBridge> model)
+{
+    if (model == nullptr || model->isThreadSafe())
+        return model;
+    return std::make_shared<SerialisedModelBridge>(std::move(model));
+}
@@ -1,9 +1,61 @@
 #pragma once
 #include <juce_core/juce_core.h>
+#include <algorithm>
+#include <span>
+#include <vector>
 #include "ECCTypes.h"
 
 struct ContextNote { int pitch; double startSec; double endSec; };
 
+// One (context, candidate set) pair in a batch. The spans must stay valid for the call.
+// maskedIndex leaves one context note out, so occlusion requests can all share the
+// caller's context instead of each carrying an edited copy.
+struct ScoreRequest
+{
+    std::span<const ContextNote> context;
+    std::span<const int> candidatePitches;
+    int maskedIndex = -1;   // context note to leave out, -1 for none
+
+    bool isMasked() const { return maskedIndex >= 0 && (size_t)maskedIndex < context.size(); }
+    size_t contextSize() const { return context.size() - (isMasked() ? 1 : 0); }
+
+    // The context as the model should see it: the context itself if nothing is masked,
+    // otherwise its last scratch.size() notes with the masked one left out, in scratch
+    std::span<const ContextNote> resolvedContext(std::span<ContextNote> scratch) const
+    {
+        if (!isMasked())
+            return context;
+
+        const size_t n = std::min(contextSize(), scratch.size());
+        const size_t start = contextSize() - n;
+        for (size_t j = 0; j < n; ++j)
+        {
+            const size_t i = start + j;
+            scratch[j] = context[i < (size_t)maskedIndex ? i : i + 1];
+        }
+        return scratch.first(n);
+    }
+};
+
+// Stateful scoring of one growing line. append() folds a note into the session's
+// state, score() reads the candidates off that state, and rollback() takes back recent
+// appends, so a note can be tried and withdrawn. Backends that encode incrementally
+// make a note-on cost one step instead of a re-encode of the whole context.
+// A session is used from one thread and must not outlive its ModelBridge.
+class ModelSession {
+public:
+    static constexpr int maxRollback = 32;
+
+    virtual ~ModelSession() = default;
+
+    virtual void append(const ContextNote& note) = 0;
+    virtual void rollback(int numNotes) = 0;   // never past size(), or more than maxRollback notes back
+    virtual void reset() = 0;
+    // Same contract as ModelBridge::scoreProbabilities: one probability per candidate, no allocation
+    virtual void score(std::span<const int> candidatePitches, std::span<float> probsOut) = 0;
+    virtual int size() const = 0;              // notes appended since reset, less rollbacks
+};
+
 class ModelBridge {
 public:
     virtual ~ModelBridge() = default;
@@ -14,6 +66,133 @@ public:
         const std::vector<int>& candidatePitches,
         int keyRoot, bool isMajor) = 0;
 
+    // Probabilities only, written to probsOut (one per candidate). Used on the note-on
+    // hot path, so implementations should not allocate; the default falls back to
+    // scoreCandidates, which does.
+    virtual void scoreProbabilities(std::span<const ContextNote> context,
+                                    std::span<const int> candidatePitches,
+                                    int keyRoot, bool isMajor, std::span<float> probsOut)
+    {
+        auto rationale = scoreCandidates({ context.begin(), context.end() },
+                                         { candidatePitches.begin(), candidatePitches.end() },
+                                         keyRoot, isMajor);
+        for (size_t i = 0; i < probsOut.size(); ++i)
+            probsOut[i] = i < rationale.size() ? rationale[i].prob : 0.0f;
+    }
+
+    // Scores many requests in one call. Probabilities are written back to back:
+    // request i fills the slots after those of requests 0..i-1, so probsOut needs
+    // the total candidate count. Backends override this to share per-call setup
+    // across requests; the default just loops over scoreProbabilities.
+    virtual void scoreBatch(std::span<const ScoreRequest> requests,
+                            int keyRoot, bool isMajor, std::span<float> probsOut)
+    {
+        std::vector<ContextNote> scratch;
+        size_t offset = 0;
+        for (const auto& req : requests)
+        {
+            const size_t n = req.candidatePitches.size();
+            jassert(offset + n <= probsOut.size());
+            if (req.isMasked() && scratch.empty())
+                scratch.resize((size_t)juce::jmax(1, contextWindow()) + 1);
+            scoreProbabilities(req.resolvedContext(scratch), req.candidatePitches, keyRoot, isMajor, probsOut.subspan(offset, n));
+            offset += n;
+        }
+    }
+
+    // Session scoring in keyRoot / isMajor. The default keeps the last contextWindow()
+    // notes and passes them to scoreProbabilities on every score().
+    virtual std::unique_ptr<ModelSession> createSession(int keyRoot, bool isMajor);
+    // Most recent notes a stateless call looks at; longer contexts are equivalent to their tail
+    virtual int contextWindow() const { return 32; }
+
+    // True if stateless calls may run on several threads at once
+    virtual bool isThreadSafe() const { return false; }
+
+    // False for stand-ins such as the mock, whose scores say nothing about music
+    virtual bool isTrained() const { return true; }
+
+    static size_t totalCandidates(std::span<const ScoreRequest> requests)
+    {
+        size_t total = 0;
+        for (const auto& req : requests)
+            total += req.candidatePitches.size();
+        return total;
+    }
+
     // Factory
     static std::unique_ptr<ModelBridge> createMock();
+    static std::unique_ptr<ModelBridge> createNGram(const juce::File& modelFile);   // nullptr if missing or invalid
+    static std::unique_ptr<ModelBridge> createNeural(const juce::File& modelFile);  // nullptr if missing or invalid
+    static std::unique_ptr<ModelBridge> createRemote(const juce::String& socketPath);  // nullptr if no server answers
+    static std::unique_ptr<ModelBridge> createDefault();   // model server, neural model, n-gram model, then mock
+    // One model for several owners that may call it from different threads, e.g. the
+    // engine and the explanations. A model that is not thread-safe is wrapped so their
+    // stateless calls take turns, as do the default sessions that are built on them.
+    static std::shared_ptr<ModelBridge> share(std::unique_ptr<ModelBridge> model);
+    static juce::File getDefaultModelFile();
+    static juce::File getDefaultNeuralModelFile();
 };
+
+// Default session: a sliding window of notes, re-scored in full on each score().
+// Notes live in a ring that stores every slot twice (at i and i + capacity), as
+// SessionTimeline does, so appending never shifts and the window is one contiguous span.
+class WindowedModelSession : public ModelSession {
+public:
+    WindowedModelSession(ModelBridge& model, int keyRoot, bool isMajor)
+        : model(model), keyRoot(keyRoot), isMajor(isMajor),
+          window(juce::jmax(1, model.contextWindow())),
+          capacity(window + maxRollback),   // enough behind the window to roll back into it
+          ring((size_t)(2 * capacity))
+    {
+    }
+
+    void append(const ContextNote& note) override
+    {
+        ring[(size_t)head] = note;
+        ring[(size_t)(head + capacity)] = note;
+        head = (head + 1) % capacity;
+        stored = juce::jmin(stored + 1, capacity);
+        ++count;
+    }
+
+    void rollback(int numNotes) override
+    {
+        jassert(numNotes >= 0 && numNotes <= maxRollback && numNotes <= count);
+        numNotes = juce::jlimit(0, stored, numNotes);
+        head = (head - numNotes + capacity) % capacity;
+        stored -= numNotes;
+        count -= numNotes;
+    }
+
+    void reset() override
+    {
+        head = 0;
+        stored = 0;
+        count = 0;
+    }
+
+    void score(std::span<const int> candidatePitches, std::span<float> probsOut) override
+    {
+        const int used = juce::jmin(stored, window);
+        model.scoreProbabilities({ ring.data() + head + capacity - used, (size_t)used }, candidatePitches,
+                                 keyRoot, isMajor, probsOut);
+    }
+
+    int size() const override { return count; }
+
+private:
+    ModelBridge& model;
+    const int keyRoot;
+    const bool isMajor;
+    const int window, capacity;
+    std::vector<ContextNote> ring;
+    int head = 0;      // next slot to write
+    int stored = 0;    // notes in the ring, at most capacity
+    int count = 0;
+};
+
+inline std::unique_ptr<ModelSession> ModelBridge::createSession(int keyRoot, bool isMajor)
+{
+    return std::make_unique<WindowedModelSession>(*this, keyRoot, isMajor);
+}
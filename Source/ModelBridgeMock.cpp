@@ -1,4 +1,6 @@
 #include "ModelBridge.h"
+#include <algorithm>
+#include <array>
 #include <random>
 
 class MockModel : public ModelBridge {
@@ -6,7 +8,7 @@ public:
     std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& ctx,
         const std::vector<int>& candidates, int key, bool major) override
     {
-        std::mt19937 rng{ 12345u + (unsigned)ctx.size() + (unsigned)candidates.size() };
+        std::mt19937 rng{ seedFor(ctx.size(), candidates.size()) };
         std::uniform_real_distribution<float> U(0.05f, 0.95f);
         std::vector<Rationale> out;
         // Simple "attention": recent notes get higher weights
@@ -23,6 +25,63 @@ public:
         }
         return out;
     }
+
+    // Same draws as scoreCandidates, without building rationales
+    void scoreProbabilities(std::span<const ContextNote> ctx, std::span<const int> candidates,
+                            int key, bool major, std::span<float> probsOut) override
+    {
+        const ScoreRequest request { ctx, candidates };
+        scoreBatch({ &request, 1 }, key, major, probsOut);
+    }
+
+    // No state between calls
+    bool isThreadSafe() const override { return true; }
+    // Seeded noise, only good for exercising the plumbing
+    bool isTrained() const override { return false; }
+
+    // The draws depend only on the seed, so requests sharing a seed (e.g. every
+    // occlusion of one context) reuse the previous request's draws instead of
+    // reseeding the generator.
+    void scoreBatch(std::span<const ScoreRequest> requests, int /*key*/, bool /*major*/,
+                    std::span<float> probsOut) override
+    {
+        std::array<float, 64> draws;
+        unsigned drawnSeed = 0;
+        size_t drawnCount = 0;
+        size_t offset = 0;
+
+        for (const auto& req : requests)
+        {
+            const size_t n = std::min(req.candidatePitches.size(), probsOut.size() - offset);
+            const unsigned seed = seedFor(req.contextSize(), req.candidatePitches.size());
+            float* out = probsOut.data() + offset;
+
+            if (seed != drawnSeed || n > drawnCount)
+            {
+                std::mt19937 rng{ seed };
+                std::uniform_real_distribution<float> U(0.05f, 0.95f);
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = U(rng);
+
+                drawnSeed = seed;
+                drawnCount = std::min(n, draws.size());
+                std::copy(out, out + drawnCount, draws.begin());
+            }
+            else
+            {
+                std::copy(draws.begin(), draws.begin() + (std::ptrdiff_t)n, out);
+            }
+
+            offset += n;
+        }
+    }
+
+private:
+    // Only the last contextWindow() notes count, as for every backend
+    unsigned seedFor(size_t contextSize, size_t numCandidates) const
+    {
+        return 12345u + (unsigned)std::min(contextSize, (size_t)contextWindow()) + (unsigned)numCandidates;
+    }
 };
 
 std::unique_ptr<ModelBridge> ModelBridge::createMock(){ return std::make_unique<MockModel>(); }
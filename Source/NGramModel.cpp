@@ -0,0 +1,478 @@
+#include "NGramModel.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    constexpr int tokenBits = 11;
+    static_assert(NGram::numTokens <= (1 << tokenBits));
+    static_assert(NGram::maxOrder * tokenBits <= 56);
+
+    constexpr juce::uint64 contextFlag = 1ull << 63;
+    constexpr int orderShift = 60;
+    constexpr juce::uint64 minorFlag = 1ull << 59;
+    constexpr juce::uint32 fileVersion = 1;
+    constexpr float backOff = 0.4f;
+
+    juce::uint64 mix(juce::uint64 x)
+    {
+        // splitmix64 finaliser
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27; x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    int motionOf(int prevMove, int move)
+    {
+        if (move == 0) return NGram::Repeat;
+        if (prevMove == NGram::noMove || prevMove == 0) return NGram::First;
+        return ((prevMove > 0) == (move > 0)) ? NGram::SameDirection : NGram::Reversal;
+    }
+
+    // Krumhansl-Kessler key profiles
+    constexpr float majorProfile[12] = { 6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f };
+    constexpr float minorProfile[12] = { 6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f };
+}
+
+namespace NGram
+{
+    int token(int prevMove, int prevPitch, int pitch, int keyRoot)
+    {
+        const int move = pitch - prevPitch;
+        const int interval = juce::jlimit(-maxInterval, maxInterval, move);
+        const int pc = ((pitch - keyRoot) % 12 + 12) % 12;
+        return ((interval + maxInterval) * 4 + motionOf(prevMove, move)) * 12 + pc;
+    }
+
+    juce::uint64 key(std::span<const int> tokens, bool minor, bool contextOnly)
+    {
+        juce::uint64 k = ((juce::uint64)tokens.size() << orderShift) | (minor ? minorFlag : 0) | (contextOnly ? contextFlag : 0);
+        for (size_t i = 0; i < tokens.size(); ++i)
+            k |= (juce::uint64)tokens[i] << (tokenBits * i);
+        return k;
+    }
+
+    int tokenize(std::span<const int> pitches, int keyRoot, int* out)
+    {
+        int n = 0;
+        int prevMove = noMove;
+        for (size_t i = 1; i < pitches.size(); ++i)
+        {
+            out[n++] = token(prevMove, pitches[i - 1], pitches[i], keyRoot);
+            prevMove = pitches[i] - pitches[i - 1];
+        }
+        return n;
+    }
+
+    void estimateKey(const juce::MidiFile& file, int& keyRoot, bool& minor)
+    {
+        float histogram[12] = {};
+
+        for (int t = 0; t < file.getNumTracks(); ++t)
+        {
+            for (const auto* event : *file.getTrack(t))
+            {
+                const auto& msg = event->message;
+                if (msg.isKeySignatureMetaEvent())
+                {
+                    minor = !msg.isKeySignatureMajorKey();
+                    const int majorTonic = ((msg.getKeySignatureNumberOfSharpsOrFlats() * 7) % 12 + 12) % 12;
+                    keyRoot = minor ? (majorTonic + 9) % 12 : majorTonic;
+                    return;
+                }
+                if (msg.isNoteOn())
+                    histogram[msg.getNoteNumber() % 12] += 1.0f;
+            }
+        }
+
+        estimateKey(histogram, keyRoot, minor);
+    }
+
+    void estimateKey(std::span<const float, 12> histogram, int& keyRoot, bool& minor)
+    {
+        float best = -1.0e9f;
+        keyRoot = 0;
+        minor = false;
+        for (int root = 0; root < 12; ++root)
+        {
+            for (int mode = 0; mode < 2; ++mode)
+            {
+                const float* profile = mode == 0 ? majorProfile : minorProfile;
+                float fit = 0.0f;
+                for (int pc = 0; pc < 12; ++pc)
+                    fit += histogram[(pc + root) % 12] * profile[pc];
+                if (fit > best)
+                {
+                    best = fit;
+                    keyRoot = root;
+                    minor = mode == 1;
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+void NGramBuilder::addLine(std::span<const int> pitches, int keyRoot, bool minor)
+{
+    if (pitches.size() < 2)
+        return;
+
+    std::vector<int> tokens(pitches.size());
+    const int n = NGram::tokenize(pitches, keyRoot, tokens.data());
+
+    for (int i = 0; i < n; ++i)
+    {
+        for (int order = 1; order <= NGram::maxOrder && order <= i + 1; ++order)
+        {
+            const int* first = tokens.data() + (i + 1 - order);
+            add(NGram::key({ first, (size_t)order }, minor, false));
+            if (order > 1)
+                add(NGram::key({ first, (size_t)(order - 1) }, minor, true));
+        }
+    }
+
+    totalTokens[minor ? 1 : 0] += (juce::uint64)n;
+}
+
+std::vector<std::vector<int>> NGramBuilder::outerVoices(const juce::MidiFile& midi)
+{
+    // Outer voices: the track with the highest average pitch against the one with the
+    // lowest, or the top and bottom notes of a single polyphonic track
+    std::vector<const juce::MidiMessageSequence*> tracks;
+    int topTrack = -1, bottomTrack = -1;
+    double topMean = -1.0, bottomMean = 1000.0;
+
+    for (int t = 0; t < midi.getNumTracks(); ++t)
+    {
+        const auto* track = midi.getTrack(t);
+        double sum = 0.0;
+        int notes = 0;
+        for (const auto* event : *track)
+            if (event->message.isNoteOn())
+            {
+                sum += event->message.getNoteNumber();
+                ++notes;
+            }
+
+        if (notes == 0)
+            continue;
+
+        const double mean = sum / (double)notes;
+        const int index = (int)tracks.size();
+        tracks.push_back(track);
+        if (mean > topMean) { topMean = mean; topTrack = index; }
+        if (mean < bottomMean) { bottomMean = mean; bottomTrack = index; }
+    }
+
+    std::vector<std::vector<int>> voices;
+    if (tracks.empty())
+        return voices;
+
+    // The highest (or lowest) sounding note of a track after each onset, kept only when
+    // that note starts there: a note held while another voice of the same track moves,
+    // or a chord member below the top, is not a new note of the outer line
+    auto line = [](const juce::MidiMessageSequence& track, bool highest) {
+        std::array<int, 128> sounding {};        // note-ons not yet released, per pitch
+        std::array<bool, 128> started {};        // started at the current tick
+        std::vector<int> out;
+
+        auto emit = [&] {
+            for (int i = 0; i < 128; ++i)
+            {
+                const int p = highest ? 127 - i : i;
+                if (sounding[(size_t)p] > 0)
+                {
+                    if (started[(size_t)p])
+                        out.push_back(p);
+                    break;
+                }
+            }
+            started.fill(false);
+        };
+
+        const int numEvents = track.getNumEvents();
+        for (int e = 0; e < numEvents;)
+        {
+            // Every event at one tick together, releases first, so a repeated note restarts
+            const double tick = track.getEventTime(e);
+            int end = e;
+            while (end < numEvents && track.getEventTime(end) == tick)
+                ++end;
+
+            bool anyStart = false;
+            for (int k = e; k < end; ++k)
+            {
+                const auto& msg = track.getEventPointer(k)->message;
+                if (msg.isNoteOff() && sounding[(size_t)msg.getNoteNumber()] > 0)
+                    --sounding[(size_t)msg.getNoteNumber()];
+            }
+            for (int k = e; k < end; ++k)
+            {
+                const auto& msg = track.getEventPointer(k)->message;
+                if (msg.isNoteOn())
+                {
+                    ++sounding[(size_t)msg.getNoteNumber()];
+                    started[(size_t)msg.getNoteNumber()] = true;
+                    anyStart = true;
+                }
+            }
+
+            if (anyStart)
+                emit();
+            e = end;
+        }
+        return out;
+    };
+
+    voices.push_back(line(*tracks[(size_t)topTrack], true));
+    auto bottom = line(*tracks[(size_t)bottomTrack], false);
+    if (bottom != voices.front())
+        voices.push_back(std::move(bottom));
+    return voices;
+}
+
+void NGramBuilder::addMidi(const juce::MidiFile& midi)
+{
+    int keyRoot = 0;
+    bool minor = false;
+    NGram::estimateKey(midi, keyRoot, minor);
+
+    // Both outer voices are lines the generator may have to write
+    for (const auto& voice : outerVoices(midi))
+        addLine(voice, keyRoot, minor);
+}
+
+bool NGramBuilder::addMidiFile(const juce::File& midiFile)
+{
+    juce::FileInputStream in(midiFile);
+    juce::MidiFile midi;
+    if (!in.openedOk() || !midi.readFrom(in))
+        return false;
+
+    addMidi(midi);
+    return true;
+}
+
+int NGramBuilder::addDirectory(const juce::File& directory)
+{
+    int used = 0;
+    for (const auto& f : directory.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi"))
+        if (addMidiFile(f))
+            ++used;
+    return used;
+}
+
+void NGramBuilder::merge(const NGramBuilder& other)
+{
+    for (const auto& [k, c] : other.counts)
+        counts[k] += c;
+    totalTokens[0] += other.totalTokens[0];
+    totalTokens[1] += other.totalTokens[1];
+}
+
+bool NGramBuilder::write(const juce::File& modelFile) const
+{
+    juce::uint32 numSlots = 16;
+    while (numSlots < counts.size() * 2)
+        numSlots <<= 1;
+
+    std::vector<NGram::Entry> slots(numSlots, NGram::Entry { 0, 0, 0 });
+    const juce::uint32 mask = numSlots - 1;
+    for (const auto& [k, c] : counts)
+    {
+        juce::uint32 i = (juce::uint32)mix(k) & mask;
+        while (slots[i].key != 0)
+            i = (i + 1) & mask;
+        slots[i] = { k, c, 0 };
+    }
+
+    NGram::FileHeader header {};
+    std::memcpy(header.magic, "PMNG", 4);
+    header.version = fileVersion;
+    header.maxOrder = NGram::maxOrder;
+    header.numSlots = numSlots;
+    header.numEntries = counts.size();
+    header.totalTokens[0] = totalTokens[0];
+    header.totalTokens[1] = totalTokens[1];
+
+    modelFile.deleteFile();
+    juce::FileOutputStream os(modelFile);
+    if (!os.openedOk())
+        return false;
+
+    return os.write(&header, sizeof(header))
+        && os.write(slots.data(), slots.size() * sizeof(NGram::Entry));
+}
+
+//==============================================================================
+NGramModel::NGramModel(std::unique_ptr<juce::MemoryMappedFile> mapped)
+    : file(std::move(mapped))
+{
+    header = static_cast<const NGram::FileHeader*>(file->getData());
+    slots = reinterpret_cast<const NGram::Entry*>(header + 1);
+    slotMask = header->numSlots - 1;
+}
+
+std::unique_ptr<NGramModel> NGramModel::open(const juce::File& modelFile)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(modelFile, juce::MemoryMappedFile::readOnly);
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof(NGram::FileHeader))
+        return nullptr;
+
+    const auto* h = static_cast<const NGram::FileHeader*>(mapped->getData());
+    if (std::memcmp(h->magic, "PMNG", 4) != 0 || h->version != fileVersion
+        || h->maxOrder != (juce::uint32)NGram::maxOrder
+        || h->numSlots == 0 || !juce::isPowerOfTwo(h->numSlots) || h->numEntries >= h->numSlots
+        || mapped->getSize() < sizeof(NGram::FileHeader) + (size_t)h->numSlots * sizeof(NGram::Entry))
+        return nullptr;
+
+    return std::unique_ptr<NGramModel>(new NGramModel(std::move(mapped)));
+}
+
+juce::uint32 NGramModel::lookup(juce::uint64 key) const
+{
+    // open() guarantees an empty slot, but the header is only as good as the file: a
+    // corrupt table with none still stops after one lap
+    juce::uint32 i = (juce::uint32)mix(key) & slotMask;
+    for (juce::uint32 probes = 0; probes <= slotMask; ++probes, i = (i + 1) & slotMask)
+    {
+        const auto& e = slots[i];
+        if (e.key == key) return e.count;
+        if (e.key == 0) return 0;
+    }
+    return 0;
+}
+
+float NGramModel::score(const int* contextTokens, int numContext, int candidateToken, bool minor, int& usedOrder) const
+{
+    int tokens[NGram::maxOrder];
+    float weight = 1.0f;
+
+    for (int k = std::min(numContext, NGram::maxOrder - 1); k >= 1; --k)
+    {
+        std::copy(contextTokens + numContext - k, contextTokens + numContext, tokens);
+        tokens[k] = candidateToken;
+
+        if (const juce::uint32 count = lookup(NGram::key({ tokens, (size_t)k + 1 }, minor, false)))
+        {
+            if (const juce::uint32 total = lookup(NGram::key({ tokens, (size_t)k }, minor, true)))
+            {
+                usedOrder = k + 1;
+                return weight * (float)count / (float)total;
+            }
+        }
+        weight *= backOff;
+    }
+
+    // Add-one unigram so unseen moves keep a little probability
+    tokens[0] = candidateToken;
+    usedOrder = 1;
+    const double total = (double)header->totalTokens[minor ? 1 : 0] + NGram::numTokens;
+    return weight * (float)((lookup(NGram::key({ tokens, 1 }, minor, false)) + 1.0) / total);
+}
+
+void NGramModel::scoreRequest(std::span<const ContextNote> context, std::span<const int> candidates,
+                              int keyRoot, bool isMajor, float* probsOut, int* ordersOut) const
+{
+    const size_t n = candidates.size();
+    if (context.empty())
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            probsOut[i] = n > 0 ? 1.0f / (float)n : 0.0f;
+            ordersOut[i] = 0;
+        }
+        return;
+    }
+
+    // The last maxOrder + 1 notes give maxOrder - 1 context tokens with correct motion
+    int pitches[NGram::maxOrder + 1];
+    const size_t numPitches = std::min(context.size(), (size_t)NGram::maxOrder + 1);
+    for (size_t i = 0; i < numPitches; ++i)
+        pitches[i] = context[context.size() - numPitches + i].pitch;
+
+    int tokens[NGram::maxOrder + 1];
+    const int numTokens = NGram::tokenize({ pitches, numPitches }, keyRoot, tokens);
+    const int usable = std::min(numTokens, NGram::maxOrder - 1);
+    const int* contextTokens = tokens + (numTokens - usable);
+
+    const int last = pitches[numPitches - 1];
+    const int lastMove = numPitches >= 2 ? last - pitches[numPitches - 2] : NGram::noMove;
+    const bool minor = !isMajor;
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int t = NGram::token(lastMove, last, candidates[i], keyRoot);
+        probsOut[i] = score(contextTokens, usable, t, minor, ordersOut[i]);
+        sum += probsOut[i];
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        probsOut[i] = sum > 0.0f ? probsOut[i] / sum : 1.0f / (float)n;
+}
+
+void NGramModel::scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                            std::span<float> probsOut)
+{
+    int orders[64];
+    std::array<ContextNote, NGram::maxOrder + 1> tail;
+    size_t offset = 0;
+    for (const auto& req : requests)
+    {
+        const auto context = req.resolvedContext(tail);
+        // Requests are small candidate sets; larger ones are scored in chunks of 64
+        for (size_t start = 0; start < req.candidatePitches.size(); start += std::size(orders))
+        {
+            const auto chunk = req.candidatePitches.subspan(start, std::min(std::size(orders), req.candidatePitches.size() - start));
+            jassert(offset + chunk.size() <= probsOut.size());
+            scoreRequest(context, chunk, keyRoot, isMajor, probsOut.data() + offset, orders);
+            offset += chunk.size();
+        }
+    }
+}
+
+void NGramModel::scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                    int keyRoot, bool isMajor, std::span<float> probsOut)
+{
+    const ScoreRequest request { context, candidatePitches };
+    scoreBatch({ &request, 1 }, keyRoot, isMajor, probsOut);
+}
+
+std::vector<Rationale> NGramModel::scoreCandidates(const std::vector<ContextNote>& ctx,
+                                                   const std::vector<int>& candidates, int keyRoot, bool isMajor)
+{
+    std::vector<float> probs(candidates.size());
+    std::vector<int> orders(candidates.size());
+    scoreRequest(ctx, candidates, keyRoot, isMajor, probs.data(), orders.data());
+
+    std::vector<Rationale> out;
+    out.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        Rationale r;
+        r.candidatePitch = candidates[i];
+        r.prob = probs[i];
+
+        const int contextUsed = std::max(0, orders[i] - 1);
+        r.summary = contextUsed > 0 ? "N-gram: seen after the last " + juce::String(contextUsed) + " move(s) in the corpus."
+                                    : "N-gram: unseen continuation, scored by how common the move is.";
+
+        // The notes that formed the matched context, most recent first
+        for (int k = 0; k <= contextUsed && k < (int)ctx.size(); ++k)
+        {
+            const auto& note = ctx[ctx.size() - 1 - (size_t)k];
+            r.influences.push_back({ note.pitch, note.startSec, note.endSec, 1.0f - 0.2f * (float)k });
+        }
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+//==============================================================================
+std::unique_ptr<ModelBridge> ModelBridge::createNGram(const juce::File& modelFile)
+{
+    return NGramModel::open(modelFile);
+}
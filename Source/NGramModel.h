@@ -0,0 +1,123 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "ModelBridge.h"
+#include "NoteHistory.h"
+
+// Variable-order n-gram model over melodic tokens. A token describes one move of a
+// line: the signed interval from the previous note (clamped to an octave), its motion
+// relative to the previous move (same direction / reversal / repeat), and the pitch
+// class of the new note relative to the key root. The major/minor mode is part of
+// every key, so the two modes are counted separately.
+namespace NGram
+{
+    constexpr int maxOrder = 4;        // up to 3 tokens of context
+    constexpr int maxInterval = 12;
+    constexpr int numTokens = (2 * maxInterval + 1) * 4 * 12;
+
+    // First = no earlier move to compare with (start of line, or after a repeat)
+    enum Motion { First = 0, SameDirection = 1, Reversal = 2, Repeat = 3 };
+    constexpr int noMove = 1000;
+
+    // Token for moving from prevPitch to pitch; prevMove is the move before that, or noMove
+    int token(int prevMove, int prevPitch, int pitch, int keyRoot);
+
+    // Key of an n-gram (context tokens followed by the predicted token), or of a context alone
+    juce::uint64 key(std::span<const int> tokens, bool minor, bool contextOnly);
+
+    // Lines are tokenised the same way for training and scoring
+    int tokenize(std::span<const int> pitches, int keyRoot, int* out);
+
+    // Tonic and mode from a key signature meta event, or a Krumhansl profile match otherwise
+    void estimateKey(const juce::MidiFile& file, int& keyRoot, bool& minor);
+    // Krumhansl profile match of a pitch-class histogram (index 0 = C)
+    void estimateKey(std::span<const float, 12> histogram, int& keyRoot, bool& minor);
+
+    struct FileHeader
+    {
+        char magic[4];                 // "PMNG"
+        juce::uint32 version;
+        juce::uint32 maxOrder;
+        juce::uint32 numSlots;         // power of two
+        juce::uint64 numEntries;
+        juce::uint64 totalTokens[2];   // unigram totals for major / minor
+        juce::uint8 reserved[24];
+    };
+    static_assert(sizeof(FileHeader) == 64);
+
+    // Open-addressing slot; key 0 marks an empty slot
+    struct Entry
+    {
+        juce::uint64 key;
+        juce::uint32 count;
+        juce::uint32 reserved;
+    };
+    static_assert(sizeof(Entry) == 16);
+}
+
+// Counts n-grams from MIDI files and writes the memory-mappable model file.
+// Builders are independent, so trainers can give each thread its own and merge them.
+class NGramBuilder {
+public:
+    void addLine(std::span<const int> pitches, int keyRoot, bool minor);
+    void addMidi(const juce::MidiFile& midi);
+    bool addMidiFile(const juce::File& midiFile);     // false if unreadable
+    int addDirectory(const juce::File& directory);    // *.mid / *.midi, recursive; returns files used
+
+    void merge(const NGramBuilder& other);
+
+    // The outer voices of a file, each as the pitches of the notes it starts: top first,
+    // then bottom. One line if the file has only one voice, none if it has no notes. Each
+    // is counted as a melodic line on its own; the models score one line at a time, so no
+    // two-voice pair tokens are counted.
+    static std::vector<std::vector<int>> outerVoices(const juce::MidiFile& midi);
+    bool write(const juce::File& modelFile) const;
+
+    size_t getNumEntries() const { return counts.size(); }
+    juce::uint64 getNumTokens() const { return totalTokens[0] + totalTokens[1]; }
+
+private:
+    void add(juce::uint64 key) { ++counts[key]; }
+
+    std::unordered_map<juce::uint64, juce::uint32> counts;
+    juce::uint64 totalTokens[2] = { 0, 0 };
+};
+
+// ModelBridge backed by a memory-mapped model file. Loading maps the file and checks
+// the header; lookups hash straight into the mapped table with stupid back-off.
+// The model is read-only after opening, so it is safe to share between threads.
+class NGramModel : public ModelBridge {
+public:
+    static std::unique_ptr<NGramModel> open(const juce::File& modelFile);
+
+    std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& context,
+                                           const std::vector<int>& candidatePitches,
+                                           int keyRoot, bool isMajor) override;
+    void scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                            int keyRoot, bool isMajor, std::span<float> probsOut) override;
+    void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                    std::span<float> probsOut) override;
+
+    // Only the last maxOrder + 1 notes affect a score, so sessions keep just those
+    int contextWindow() const override { return NGram::maxOrder + 1; }
+    bool isThreadSafe() const override { return true; }
+
+    const NGram::FileHeader& getHeader() const { return *header; }
+
+private:
+    explicit NGramModel(std::unique_ptr<juce::MemoryMappedFile> mapped);
+
+    juce::uint32 lookup(juce::uint64 key) const;
+    // Back-off score of one candidate; usedOrder reports the longest context that matched
+    float score(const int* contextTokens, int numContext, int candidateToken, bool minor, int& usedOrder) const;
+    // Normalised probabilities for one request; returns the order used for each candidate
+    void scoreRequest(std::span<const ContextNote> context, std::span<const int> candidates,
+                      int keyRoot, bool isMajor, float* probsOut, int* ordersOut) const;
+
+    std::unique_ptr<juce::MemoryMappedFile> file;
+    const NGram::FileHeader* header = nullptr;
+    const NGram::Entry* slots = nullptr;
+    juce::uint32 slotMask = 0;
+};
@@ -0,0 +1,523 @@
+#include "NeuralModel.h"
+#include "SimdTarget.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    constexpr juce::uint32 fileVersion = 1;
+    constexpr int maxKernelCols = 1024;
+
+    struct FileHeader
+    {
+        char magic[4];   // "PMNN"
+        juce::uint32 version, vocab, embed, hidden, outputs;
+        juce::uint8 reserved[8];
+    };
+    static_assert(sizeof(FileHeader) == 32);
+
+    size_t matrixBytes(int rows, int cols) { return (size_t)rows * (size_t)cols + (size_t)rows * sizeof(float); }
+
+    size_t expectedSize(const NeuralModel::Dims& d)
+    {
+        const int gates = 3 * d.hidden;
+        return sizeof(FileHeader)
+             + matrixBytes(d.vocab, d.embed) + matrixBytes(gates, d.embed)
+             + matrixBytes(gates, d.hidden) + matrixBytes(d.outputs, d.hidden)
+             + (size_t)(2 * gates + d.outputs) * sizeof(float);
+    }
+
+    // Rational tanh, exact at 0 and saturating at |v| >= 3 (max error ~2e-2); the gates
+    // only need to be as precise as the int8 weights feeding them
+    float fastTanh(float v)
+    {
+        v = juce::jlimit(-3.0f, 3.0f, v);
+        const float v2 = v * v;
+        return v * (27.0f + v2) / (27.0f + 9.0f * v2);
+    }
+
+    float sigmoid(float v) { return 0.5f + 0.5f * fastTanh(0.5f * v); }
+
+   #if JUCE_INTEL
+    POLYMUSE_TARGET_AVX2
+    void matVecAvx2(const juce::int8* W, const float* rowScales, int rows, int cols,
+                    const juce::int8* x, float xScale, float* out)
+    {
+        // Widen x to int16 once; every row reuses it
+        __m256i xs[maxKernelCols / 16];
+        const int chunks = cols / 16;
+        for (int c = 0; c < chunks; ++c)
+            xs[c] = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + c * 16)));
+
+        for (int r = 0; r < rows; ++r)
+        {
+            const juce::int8* row = W + (size_t)r * (size_t)cols;
+            __m256i acc = _mm256_setzero_si256();
+            for (int c = 0; c < chunks; ++c)
+            {
+                const __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + c * 16)));
+                acc = _mm256_add_epi32(acc, _mm256_madd_epi16(w, xs[c]));
+            }
+
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            sum = _mm_hadd_epi32(sum, sum);
+            sum = _mm_hadd_epi32(sum, sum);
+            out[r] = rowScales[r] * xScale * (float)_mm_cvtsi128_si32(sum);
+        }
+    }
+   #endif
+
+   #if POLYMUSE_HAS_NEON
+    void matVecNeon(const juce::int8* W, const float* rowScales, int rows, int cols,
+                    const juce::int8* x, float xScale, float* out)
+    {
+        for (int r = 0; r < rows; ++r)
+        {
+            const juce::int8* row = W + (size_t)r * (size_t)cols;
+            int32x4_t acc = vdupq_n_s32(0);
+            for (int c = 0; c < cols; c += 16)
+            {
+                const int8x16_t w = vld1q_s8(row + c);
+                const int8x16_t v = vld1q_s8(x + c);
+                acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(w), vget_low_s8(v)));
+                acc = vpadalq_s16(acc, vmull_s8(vget_high_s8(w), vget_high_s8(v)));
+            }
+
+            const int sum = vgetq_lane_s32(acc, 0) + vgetq_lane_s32(acc, 1)
+                          + vgetq_lane_s32(acc, 2) + vgetq_lane_s32(acc, 3);
+            out[r] = rowScales[r] * xScale * (float)sum;
+        }
+    }
+   #endif
+
+    using MatVecFn = void (*)(const juce::int8*, const float*, int, int, const juce::int8*, float, float*);
+
+    struct Kernel
+    {
+        MatVecFn fn;
+        const char* name;
+    };
+
+    Kernel chooseKernel()
+    {
+       #if JUCE_INTEL
+        if (juce::SystemStats::hasAVX2())
+            return { matVecAvx2, "avx2" };
+       #elif POLYMUSE_HAS_NEON
+        return { matVecNeon, "neon" };
+       #endif
+        return { NeuralKernels::matVecScalar, "scalar" };
+    }
+
+    const Kernel& activeKernel()
+    {
+        static const Kernel kernel = chooseKernel();
+        return kernel;
+    }
+
+    // Quantises a float matrix row by row and appends weights then scales
+    void appendMatrix(juce::MemoryOutputStream& os, const std::vector<float>& m, int rows, int cols)
+    {
+        std::vector<juce::int8> q((size_t)rows * (size_t)cols);
+        std::vector<float> scales((size_t)rows);
+        for (int r = 0; r < rows; ++r)
+            scales[(size_t)r] = NeuralKernels::quantize(m.data() + (size_t)r * (size_t)cols, cols, q.data() + (size_t)r * (size_t)cols);
+
+        os.write(q.data(), q.size());
+        os.write(scales.data(), scales.size() * sizeof(float));
+    }
+}
+
+namespace NeuralKernels
+{
+    void matVecScalar(const juce::int8* W, const float* rowScales, int rows, int cols,
+                      const juce::int8* x, float xScale, float* out)
+    {
+        for (int r = 0; r < rows; ++r)
+        {
+            const juce::int8* row = W + (size_t)r * (size_t)cols;
+            int sum = 0;
+            for (int c = 0; c < cols; ++c)
+                sum += (int)row[c] * (int)x[c];
+            out[r] = rowScales[r] * xScale * (float)sum;
+        }
+    }
+
+    void matVec(const juce::int8* W, const float* rowScales, int rows, int cols,
+                const juce::int8* x, float xScale, float* out)
+    {
+        jassert(cols % 16 == 0 && cols <= maxKernelCols);
+        activeKernel().fn(W, rowScales, rows, cols, x, xScale, out);
+    }
+
+    const char* activeKernelName() { return activeKernel().name; }
+
+    float quantize(const float* in, int n, juce::int8* out)
+    {
+        float maxAbs = 0.0f;
+        for (int i = 0; i < n; ++i)
+            maxAbs = std::max(maxAbs, std::abs(in[i]));
+
+        const float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+        const float inv = 1.0f / scale;
+        for (int i = 0; i < n; ++i)
+        {
+            const float v = in[i] * inv;
+            out[i] = (juce::int8)juce::jlimit(-127, 127, (int)(v + (v >= 0.0f ? 0.5f : -0.5f)));
+        }
+        return scale;
+    }
+}
+
+//==============================================================================
+NeuralModel::FloatWeights NeuralModel::FloatWeights::random(const Dims& dims, juce::uint32 seed)
+{
+    FloatWeights w;
+    w.dims = dims;
+    std::mt19937 rng(seed);
+
+    auto fill = [&rng](std::vector<float>& v, size_t n, int fanIn) {
+        const float a = 1.0f / std::sqrt((float)fanIn);
+        std::uniform_real_distribution<float> U(-a, a);
+        v.resize(n);
+        for (auto& x : v) x = U(rng);
+    };
+
+    const int gates = 3 * dims.hidden;
+    fill(w.embedding, (size_t)dims.vocab * (size_t)dims.embed, 1);
+    fill(w.W, (size_t)gates * (size_t)dims.embed, dims.embed);
+    fill(w.U, (size_t)gates * (size_t)dims.hidden, dims.hidden);
+    fill(w.head, (size_t)dims.outputs * (size_t)dims.hidden, dims.hidden);
+    w.bW.assign((size_t)gates, 0.0f);
+    w.bU.assign((size_t)gates, 0.0f);
+    w.bHead.assign((size_t)dims.outputs, 0.0f);
+    return w;
+}
+
+bool NeuralModel::write(const FloatWeights& w, const juce::File& modelFile)
+{
+    const auto& d = w.dims;
+    const int gates = 3 * d.hidden;
+    if (d.embed % 16 != 0 || d.hidden % 16 != 0 || d.vocab != numInputTokens || d.outputs != numIntervals + 12)
+        return false;
+
+    juce::MemoryOutputStream os;
+    FileHeader header {};
+    std::memcpy(header.magic, "PMNN", 4);
+    header.version = fileVersion;
+    header.vocab = (juce::uint32)d.vocab;
+    header.embed = (juce::uint32)d.embed;
+    header.hidden = (juce::uint32)d.hidden;
+    header.outputs = (juce::uint32)d.outputs;
+    os.write(&header, sizeof(header));
+
+    appendMatrix(os, w.embedding, d.vocab, d.embed);
+    appendMatrix(os, w.W, gates, d.embed);
+    appendMatrix(os, w.U, gates, d.hidden);
+    appendMatrix(os, w.head, d.outputs, d.hidden);
+    os.write(w.bW.data(), (size_t)gates * sizeof(float));
+    os.write(w.bU.data(), (size_t)gates * sizeof(float));
+    os.write(w.bHead.data(), (size_t)d.outputs * sizeof(float));
+
+    jassert(os.getDataSize() == expectedSize(d));
+    return modelFile.replaceWithData(os.getData(), os.getDataSize());
+}
+
+std::unique_ptr<NeuralModel> NeuralModel::open(const juce::File& modelFile)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(modelFile, juce::MemoryMappedFile::readOnly);
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof(FileHeader))
+        return nullptr;
+
+    const auto* h = static_cast<const FileHeader*>(mapped->getData());
+    Dims d;
+    d.vocab = (int)h->vocab;
+    d.embed = (int)h->embed;
+    d.hidden = (int)h->hidden;
+    d.outputs = (int)h->outputs;
+
+    if (std::memcmp(h->magic, "PMNN", 4) != 0 || h->version != fileVersion
+        || d.vocab != numInputTokens || d.outputs != numIntervals + 12
+        || d.embed <= 0 || d.embed % 16 != 0 || d.embed > maxKernelCols
+        || d.hidden <= 0 || d.hidden % 16 != 0 || d.hidden > maxKernelCols
+        || mapped->getSize() < expectedSize(d))
+        return nullptr;
+
+    return std::unique_ptr<NeuralModel>(new NeuralModel(std::move(mapped)));
+}
+
+NeuralModel::NeuralModel(std::unique_ptr<juce::MemoryMappedFile> mapped)
+    : file(std::move(mapped))
+{
+    const auto* header = static_cast<const FileHeader*>(file->getData());
+    dims.vocab = (int)header->vocab;
+    dims.embed = (int)header->embed;
+    dims.hidden = (int)header->hidden;
+    dims.outputs = (int)header->outputs;
+
+    const auto* p = reinterpret_cast<const juce::uint8*>(header + 1);
+    auto takeMatrix = [&p](Matrix& m, int rows, int cols) {
+        m.rows = rows;
+        m.cols = cols;
+        m.weights = reinterpret_cast<const juce::int8*>(p);
+        p += (size_t)rows * (size_t)cols;
+        m.scales = reinterpret_cast<const float*>(p);
+        p += (size_t)rows * sizeof(float);
+    };
+    auto takeFloats = [&p](const float*& v, int n) {
+        v = reinterpret_cast<const float*>(p);
+        p += (size_t)n * sizeof(float);
+    };
+
+    const int gates = 3 * dims.hidden;
+    takeMatrix(embedding, dims.vocab, dims.embed);
+    takeMatrix(W, gates, dims.embed);
+    takeMatrix(U, gates, dims.hidden);
+    takeMatrix(head, dims.outputs, dims.hidden);
+    takeFloats(bW, gates);
+    takeFloats(bU, gates);
+    takeFloats(bHead, dims.outputs);
+
+    h.resize((size_t)dims.hidden);
+    scratch.allocate(dims);
+}
+
+void NeuralModel::Scratch::allocate(const Dims& d)
+{
+    hq.resize((size_t)d.hidden);
+    gx.resize((size_t)(3 * d.hidden));
+    gh.resize((size_t)(3 * d.hidden));
+    logits.resize((size_t)d.outputs);
+}
+
+int NeuralModel::inputToken(int prevPitch, int pitch, int keyRoot)
+{
+    if (prevPitch < 0)
+        return numInputTokens - 1;
+
+    const int interval = juce::jlimit(-12, 12, pitch - prevPitch);
+    const int pc = ((pitch - keyRoot) % 12 + 12) % 12;
+    return (interval + 12) * 12 + pc;
+}
+
+void NeuralModel::step(float* state, int token, Scratch& s) const
+{
+    const int H = dims.hidden;
+
+    // Embedding rows are already int8, so they feed the kernel directly
+    NeuralKernels::matVec(W.weights, W.scales, W.rows, W.cols,
+                          embedding.weights + (size_t)token * (size_t)dims.embed, embedding.scales[token], s.gx.data());
+    const float hScale = NeuralKernels::quantize(state, H, s.hq.data());
+    NeuralKernels::matVec(U.weights, U.scales, U.rows, U.cols, s.hq.data(), hScale, s.gh.data());
+
+    for (int j = 0; j < H; ++j)
+    {
+        const float z = sigmoid(s.gx[(size_t)j] + bW[j] + s.gh[(size_t)j] + bU[j]);
+        const float r = sigmoid(s.gx[(size_t)(H + j)] + bW[H + j] + s.gh[(size_t)(H + j)] + bU[H + j]);
+        const float n = fastTanh(s.gx[(size_t)(2 * H + j)] + bW[2 * H + j] + r * (s.gh[(size_t)(2 * H + j)] + bU[2 * H + j]));
+        state[j] = (1.0f - z) * n + z * state[j];
+    }
+}
+
+void NeuralModel::computeLogits(const float* state, Scratch& s) const
+{
+    const float hScale = NeuralKernels::quantize(state, dims.hidden, s.hq.data());
+    NeuralKernels::matVec(head.weights, head.scales, head.rows, head.cols, s.hq.data(), hScale, s.logits.data());
+    for (int o = 0; o < dims.outputs; ++o)
+        s.logits[(size_t)o] += bHead[o];
+}
+
+void NeuralModel::candidateProbs(const float* logits, int lastPitch, std::span<const int> candidates,
+                                 int keyRoot, float* probsOut)
+{
+    if (candidates.empty())
+        return;
+
+    float maxLogit = -1.0e30f;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        const int c = candidates[i];
+        float logit = logits[numIntervals + ((c - keyRoot) % 12 + 12) % 12];
+        if (lastPitch >= 0)
+            logit += logits[juce::jlimit(-12, 12, c - lastPitch) + 12];
+        probsOut[i] = logit;
+        maxLogit = std::max(maxLogit, logit);
+    }
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        probsOut[i] = std::exp(probsOut[i] - maxLogit);
+        sum += probsOut[i];
+    }
+    for (size_t i = 0; i < candidates.size(); ++i)
+        probsOut[i] /= sum;
+}
+
+void NeuralModel::runContext(std::span<const ContextNote> context, int keyRoot)
+{
+    const size_t first = context.size() > (size_t)maxContext ? context.size() - (size_t)maxContext : 0;
+    const size_t lead = first > 0 ? first - 1 : first;
+
+    // Same window as last time: the logits are still valid
+    const int count = (int)(context.size() - lead);
+    bool same = count == cachedCount && keyRoot == cachedKey;
+    for (int i = 0; same && i < count; ++i)
+        same = cachedPitches[(size_t)i] == context[lead + (size_t)i].pitch;
+    if (same)
+        return;
+
+    cachedCount = count;
+    cachedKey = keyRoot;
+    for (int i = 0; i < count; ++i)
+        cachedPitches[(size_t)i] = context[lead + (size_t)i].pitch;
+
+    std::fill(h.begin(), h.end(), 0.0f);
+    for (size_t i = first; i < context.size(); ++i)
+        step(h.data(), inputToken(i > 0 ? context[i - 1].pitch : -1, context[i].pitch, keyRoot), scratch);
+
+    computeLogits(h.data(), scratch);
+}
+
+void NeuralModel::scoreRequest(std::span<const ContextNote> context, std::span<const int> candidates,
+                               int keyRoot, float* probsOut)
+{
+    if (candidates.empty())
+        return;
+
+    runContext(context, keyRoot);
+    candidateProbs(scratch.logits.data(), context.empty() ? -1 : context.back().pitch, candidates, keyRoot, probsOut);
+}
+
+void NeuralModel::scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool /*isMajor*/,
+                             std::span<float> probsOut)
+{
+    // One note beyond the window sets the motion into its first note
+    std::array<ContextNote, maxContext + 1> tail;
+    size_t offset = 0;
+    for (const auto& req : requests)
+    {
+        jassert(offset + req.candidatePitches.size() <= probsOut.size());
+        scoreRequest(req.resolvedContext(tail), req.candidatePitches, keyRoot, probsOut.data() + offset);
+        offset += req.candidatePitches.size();
+    }
+}
+
+void NeuralModel::scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                     int keyRoot, bool /*isMajor*/, std::span<float> probsOut)
+{
+    jassert(candidatePitches.size() <= probsOut.size());
+    scoreRequest(context, candidatePitches, keyRoot, probsOut.data());
+}
+
+std::vector<Rationale> NeuralModel::scoreCandidates(const std::vector<ContextNote>& ctx,
+                                                    const std::vector<int>& candidates, int keyRoot, bool /*isMajor*/)
+{
+    std::vector<float> probs(candidates.size());
+    scoreRequest(ctx, candidates, keyRoot, probs.data());
+
+    const int used = std::min((int)ctx.size(), maxContext);
+    std::vector<Rationale> out;
+    out.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        Rationale r;
+        r.candidatePitch = candidates[i];
+        r.prob = probs[i];
+        r.summary = "Neural: GRU over the last " + juce::String(used) + " note(s), scoring the next interval and pitch class.";
+
+        // Recurrent state weights recent notes most; report the last few
+        for (int k = 0; k < 5 && k < (int)ctx.size(); ++k)
+        {
+            const auto& note = ctx[ctx.size() - 1 - (size_t)k];
+            r.influences.push_back({ note.pitch, note.startSec, note.endSec, 1.0f - 0.18f * (float)k });
+        }
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+//==============================================================================
+// Keeps the hidden state after each of the last maxRollback appends in a ring, so
+// append is one GRU step and rollback is a copy. Unlike the stateless calls, the
+// recurrent state is never truncated to maxContext notes.
+class NeuralModel::Session : public ModelSession {
+public:
+    Session(const NeuralModel& model, int keyRoot)
+        : model(model), keyRoot(keyRoot), hidden(model.dims.hidden),
+          states((size_t)(ringSize * hidden)), pitches((size_t)ringSize)
+    {
+        scratch.allocate(model.dims);
+        reset();
+    }
+
+    void append(const ContextNote& note) override
+    {
+        const int prev = count > 0 ? pitches[slot(count)] : -1;
+        float* next = state(count + 1);
+        std::copy(state(count), state(count) + hidden, next);
+        model.step(next, inputToken(prev, note.pitch, keyRoot), scratch);
+
+        ++count;
+        pitches[slot(count)] = note.pitch;
+        oldest = std::max(oldest, count - maxRollback);
+        logitsValid = false;
+    }
+
+    void rollback(int numNotes) override
+    {
+        jassert(numNotes >= 0 && count - numNotes >= oldest);
+        count = std::max(oldest, count - std::max(0, numNotes));
+        logitsValid = false;
+    }
+
+    void reset() override
+    {
+        count = 0;
+        oldest = 0;
+        std::fill(state(0), state(0) + hidden, 0.0f);
+        logitsValid = false;
+    }
+
+    void score(std::span<const int> candidatePitches, std::span<float> probsOut) override
+    {
+        jassert(candidatePitches.size() <= probsOut.size());
+        if (!logitsValid)
+        {
+            model.computeLogits(state(count), scratch);
+            logitsValid = true;
+        }
+        candidateProbs(scratch.logits.data(), count > 0 ? pitches[slot(count)] : -1,
+                       candidatePitches, keyRoot, probsOut.data());
+    }
+
+    int size() const override { return count; }
+
+private:
+    static constexpr int ringSize = maxRollback + 1;
+
+    static size_t slot(int n) { return (size_t)(n % ringSize); }
+    float* state(int n) { return states.data() + slot(n) * (size_t)hidden; }
+
+    const NeuralModel& model;
+    const int keyRoot;
+    const int hidden;
+    std::vector<float> states;     // hidden state after n notes lives in slot(n)
+    std::vector<int> pitches;      // pitch of note n lives in slot(n)
+    Scratch scratch;
+    int count = 0, oldest = 0;
+    bool logitsValid = false;
+};
+
+std::unique_ptr<ModelSession> NeuralModel::createSession(int keyRoot, bool /*isMajor*/)
+{
+    return std::make_unique<Session>(*this, keyRoot);
+}
+
+std::unique_ptr<ModelBridge> ModelBridge::createNeural(const juce::File& modelFile)
+{
+    return NeuralModel::open(modelFile);
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <span>
+#include <vector>
+#include "ModelBridge.h"
+
+// int8 matrix-vector kernels used by NeuralModel. cols must be a multiple of 16.
+//   out[r] = rowScales[r] * xScale * sum_c W[r * cols + c] * x[c]
+namespace NeuralKernels
+{
+    void matVecScalar(const juce::int8* W, const float* rowScales, int rows, int cols,
+                      const juce::int8* x, float xScale, float* out);
+
+    // Best kernel for this CPU: AVX2 (checked at run time), NEON, or the scalar loop
+    void matVec(const juce::int8* W, const float* rowScales, int rows, int cols,
+                const juce::int8* x, float xScale, float* out);
+
+    const char* activeKernelName();
+
+    // Symmetric per-vector quantisation; returns the scale
+    float quantize(const float* in, int n, juce::int8* out);
+}
+
+// Small GRU over the context line, with int8 weights and float activations.
+// Each context note becomes a token (melodic interval from the previous note, clamped
+// to an octave, and pitch class relative to the key). After the last note, an output
+// head gives logits for the next melodic interval and the next pitch class. A
+// candidate's logit is the sum of the two that describe it, and the candidates are
+// softmaxed against each other.
+// The mode is not an input: with pitch classes relative to the tonic, the line itself
+// tells major from minor, so every isMajor argument is ignored.
+//
+// File format (little endian), all matrices int8 row-major and each followed by one
+// float scale per row:
+//   header   "PMNN", version, vocab, embed, hidden, outputs (uint32), 8 reserved bytes
+//   embedding vocab x embed, W 3*hidden x embed, U 3*hidden x hidden, head outputs x hidden,
+//   then float biases bW[3*hidden], bU[3*hidden], bHead[outputs]
+// Gate order in W/U/biases is update, reset, candidate (as in PyTorch's GRU, reset applied
+// to U h + bU).
+//
+// Scratch buffers are per instance, so one NeuralModel must not score from two threads at once.
+// Sessions carry their own scratch and only read the weights.
+class NeuralModel : public ModelBridge {
+public:
+    struct Dims
+    {
+        int vocab = numInputTokens;
+        int embed = 32;
+        int hidden = 64;
+        int outputs = numIntervals + 12;
+    };
+
+    // Float weights in the file's layout, for exporters and tests; write() quantises them
+    struct FloatWeights
+    {
+        Dims dims;
+        std::vector<float> embedding, W, U, head, bW, bU, bHead;
+
+        static FloatWeights random(const Dims& dims, juce::uint32 seed);
+    };
+
+    static bool write(const FloatWeights& weights, const juce::File& modelFile);
+    static std::unique_ptr<NeuralModel> open(const juce::File& modelFile);
+
+    std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& context,
+                                           const std::vector<int>& candidatePitches,
+                                           int keyRoot, bool isMajor) override;
+    void scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                            int keyRoot, bool isMajor, std::span<float> probsOut) override;
+    void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                    std::span<float> probsOut) override;
+
+    // Incremental GRU state: each append is one recurrent step
+    std::unique_ptr<ModelSession> createSession(int keyRoot, bool isMajor) override;
+    int contextWindow() const override { return maxContext; }
+
+    const Dims& getDims() const { return dims; }
+
+    static constexpr int maxContext = 32;           // most recent notes fed to the GRU
+    static constexpr int numIntervals = 25;         // -12 .. +12 semitones
+    static constexpr int numInputTokens = numIntervals * 12 + 1;   // + start-of-line token
+
+private:
+    struct Matrix
+    {
+        const juce::int8* weights = nullptr;
+        const float* scales = nullptr;
+        int rows = 0, cols = 0;
+    };
+
+    // Per-caller working memory for step() and computeLogits()
+    struct Scratch
+    {
+        std::vector<float> gx, gh, logits;
+        std::vector<juce::int8> hq;
+
+        void allocate(const Dims& dims);
+    };
+
+    class Session;
+
+    explicit NeuralModel(std::unique_ptr<juce::MemoryMappedFile> mapped);
+
+    static int inputToken(int prevPitch, int pitch, int keyRoot);
+    // One GRU step, updating state (dims.hidden floats) in place
+    void step(float* state, int token, Scratch& s) const;
+    void computeLogits(const float* state, Scratch& s) const;
+    static void candidateProbs(const float* logits, int lastPitch, std::span<const int> candidates,
+                               int keyRoot, float* probsOut);
+
+    void runContext(std::span<const ContextNote> context, int keyRoot);
+    void scoreRequest(std::span<const ContextNote> context, std::span<const int> candidates,
+                      int keyRoot, float* probsOut);
+
+    std::unique_ptr<juce::MemoryMappedFile> file;
+    Dims dims;
+    Matrix embedding, W, U, head;
+    const float* bW = nullptr;
+    const float* bU = nullptr;
+    const float* bHead = nullptr;
+
+    // Stateless-call state, sized once at load
+    std::vector<float> h;
+    Scratch scratch;
+
+    // Pitches (plus the note before the window) and key behind the current logits, so
+    // re-scoring the same context skips the recurrent pass
+    std::array<int, maxContext + 1> cachedPitches {};
+    int cachedCount = -1, cachedKey = 0;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+struct NotePair
+{
+    int inputPitch = 0;
+    int generatedPitch = 0;
+    double timestamp = 0.0;
+
+    NotePair() = default;
+    NotePair(int input, int generated, double time)
+        : inputPitch(input), generatedPitch(generated), timestamp(time) {}
+};
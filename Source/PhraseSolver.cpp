@@ -0,0 +1,170 @@
+#include "PhraseSolver.h"
+#include "CounterpointEngine.h"  // For NotePair definition
+#include "IntervalTables.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Vertical intervals considered for each cantus note (unison only at the ends)
+    constexpr int intervalChoices[] = { 0, 3, 4, 7, 8, 9, 12, 15, 16 };
+    constexpr int maxChoices = (int)(sizeof(intervalChoices) / sizeof(intervalChoices[0]));
+}
+
+int PhraseSolver::candidatesFor(int cantusPitch, bool above, bool isEnd, int* out) const
+{
+    // Prefer the requested side; only cross over if nothing fits the range there
+    for (int side = 0; side < 2; ++side)
+    {
+        const bool up = (side == 0) ? above : !above;
+        int n = 0;
+
+        for (int semis : intervalChoices)
+        {
+            if (isEnd ? !IntervalTables::isPerfect(semis) : semis == 0)
+                continue;
+
+            int pitch = up ? cantusPitch + semis : cantusPitch - semis;
+            if (pitch >= minPitch && pitch <= maxPitch)
+                out[n++] = pitch;
+        }
+
+        if (n > 0)
+            return n;
+    }
+
+    out[0] = juce::jlimit(minPitch, maxPitch, cantusPitch);
+    return 1;
+}
+
+float PhraseSolver::noteCost(int cantusPitch, int genPitch, bool isEnd) const
+{
+    if (isEnd)
+        return 0.0f;
+
+    int semis = std::abs(genPitch - cantusPitch);
+    if (semis == 0) return 0.3f;                 // unison blurs the voices
+    if (IntervalTables::isPerfect(semis)) return 0.1f;     // imperfect consonances preferred mid-phrase
+    return 0.0f;
+}
+
+float PhraseSolver::transitionCost(std::vector<NotePair>& window,
+                                   int prevIn, int prevGen, int inP, int genP) const
+{
+    window.clear();
+    window.emplace_back(prevIn, prevGen, 0.0);
+    window.emplace_back(inP, genP, 0.0);
+
+    float cost = 4.0f * (1.0f - ruleChecker.evaluateScore(window, inP, genP));
+
+    int leap = std::abs(genP - prevGen);
+    if (leap == 0) cost += 0.3f;
+    else if (leap <= 2) cost += 0.0f;
+    else if (leap <= 5) cost += 0.1f;
+    else if (leap == 6) cost += 0.75f;           // melodic tritone
+    else if (leap <= 7) cost += 0.25f;
+    else if (leap <= 12) cost += 0.6f;
+    else cost += 2.0f;
+
+    int moveIn = inP - prevIn;
+    int moveGen = genP - prevGen;
+    if (moveIn * moveGen > 0)
+        cost += 0.05f;                           // mild preference for contrary motion
+
+    return cost;
+}
+
+std::vector<int> PhraseSolver::solve(const std::vector<int>& cantus, bool above)
+{
+    lastCost = 0.0f;
+    const int N = (int)cantus.size();
+    if (N == 0)
+        return {};
+
+    std::vector<int> pitches((size_t)N * maxChoices);
+    std::vector<int> counts((size_t)N);
+    std::vector<float> cost((size_t)N * maxChoices);
+    std::vector<int> back((size_t)N * maxChoices, -1);
+    std::vector<NotePair> window;
+    window.reserve(2);
+
+    for (int i = 0; i < N; ++i)
+    {
+        bool isEnd = (i == 0 || i == N - 1);
+        counts[i] = candidatesFor(cantus[i], above, isEnd, &pitches[(size_t)i * maxChoices]);
+    }
+
+    for (int p = 0; p < counts[0]; ++p)
+        cost[p] = noteCost(cantus[0], pitches[p], true);
+
+    for (int i = 1; i < N; ++i)
+    {
+        const bool isEnd = (i == N - 1);
+        const int* prevPitches = &pitches[(size_t)(i - 1) * maxChoices];
+        const int* currPitches = &pitches[(size_t)i * maxChoices];
+        const float* prevCost = &cost[(size_t)(i - 1) * maxChoices];
+
+        for (int c = 0; c < counts[i]; ++c)
+        {
+            float best = std::numeric_limits<float>::max();
+            int bestPrev = 0;
+            float local = noteCost(cantus[i], currPitches[c], isEnd);
+
+            for (int p = 0; p < counts[i - 1]; ++p)
+            {
+                float total = prevCost[p] + local
+                            + transitionCost(window, cantus[i - 1], prevPitches[p], cantus[i], currPitches[c]);
+                if (total < best)
+                {
+                    best = total;
+                    bestPrev = p;
+                }
+            }
+
+            cost[(size_t)i * maxChoices + c] = best;
+            back[(size_t)i * maxChoices + c] = bestPrev;
+        }
+    }
+
+    // Trace back from the cheapest final state
+    const float* lastRow = &cost[(size_t)(N - 1) * maxChoices];
+    int state = (int)(std::min_element(lastRow, lastRow + counts[N - 1]) - lastRow);
+    lastCost = lastRow[state];
+
+    std::vector<int> line((size_t)N);
+    for (int i = N - 1; i >= 0; --i)
+    {
+        line[(size_t)i] = pitches[(size_t)i * maxChoices + state];
+        state = back[(size_t)i * maxChoices + state];
+    }
+    return line;
+}
+
+std::vector<int> PhraseSolver::solve(const juce::MidiFile& file, int trackIndex, bool above)
+{
+    return solve(cantusFromMidiTrack(file, trackIndex), above);
+}
+
+std::vector<int> PhraseSolver::cantusFromMidiTrack(const juce::MidiFile& file, int trackIndex)
+{
+    std::vector<int> cantus;
+    const auto* track = file.getTrack(trackIndex);
+    if (track == nullptr)
+        return cantus;
+
+    double lastOnset = -1.0;
+    for (const auto* event : *track)
+    {
+        const auto& msg = event->message;
+        if (!msg.isNoteOn())
+            continue;
+
+        if (!cantus.empty() && msg.getTimeStamp() == lastOnset)
+            cantus.back() = std::max(cantus.back(), msg.getNoteNumber());
+        else
+            cantus.push_back(msg.getNoteNumber());
+
+        lastOnset = msg.getTimeStamp();
+    }
+    return cantus;
+}
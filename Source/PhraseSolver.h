@@ -0,0 +1,36 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+#include "RuleChecker.h"
+
+// Forward declaration
+struct NotePair;
+
+// Offline counterpoint for a complete cantus firmus.
+// Viterbi over one generated pitch per cantus note: each transition is costed on the
+// (previous pair, current pair) window with RuleChecker::evaluateScore, so a phrase of
+// N notes with P candidates per note costs O(N * P^2) rule evaluations.
+class PhraseSolver {
+public:
+    // Returns one generated pitch per cantus note (empty if the cantus is empty).
+    std::vector<int> solve(const std::vector<int>& cantus, bool above);
+    std::vector<int> solve(const juce::MidiFile& file, int trackIndex, bool above);
+
+    // Note-on pitches of one track in time order, keeping the highest note of each onset.
+    static std::vector<int> cantusFromMidiTrack(const juce::MidiFile& file, int trackIndex);
+
+    // Total cost of the last solved line (0 = no rule or style penalties)
+    float getLastCost() const { return lastCost; }
+
+    static constexpr int minPitch = 36;
+    static constexpr int maxPitch = 84;
+
+private:
+    int candidatesFor(int cantusPitch, bool above, bool isEnd, int* out) const;
+    float noteCost(int cantusPitch, int genPitch, bool isEnd) const;
+    float transitionCost(std::vector<NotePair>& window,
+                         int prevIn, int prevGen, int inP, int genP) const;
+
+    RuleChecker ruleChecker;
+    float lastCost = 0.0f;
+};
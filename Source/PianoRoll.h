@@ -17,6 +17,7 @@ struct NoteEvent
     double startTime;   // Start time in seconds
     double endTime;     // End time in seconds (-1.0 if note is still active)
     bool active;        // Whether the note is currently playing
+    bool crossing = false;  // Generated note the rule checker found crossing the input voice
     
     NoteEvent(int v, int p, float vel, double start, double end = -1.0, bool a = true)
         : voice(v), pitch(p), velocity(vel), startTime(start), endTime(end), active(a) {}
@@ -56,7 +57,7 @@ public:
     void timerCallback() override;
 
     // Note management
-    void noteOn(int voice, int pitch, float velocity = 64.0f);
+    void noteOn(int voice, int pitch, float velocity = 64.0f, bool crossing = false);
     void noteOff(int voice, int pitch);
     void clearAllNotes();
     void clearVoice(int voice);
@@ -86,12 +87,6 @@ public:
     // Influence highlighting API
     void setInfluences(const std::vector<Influence>& infl){ influences = infl; }
     
-    // Voice crossing detection
-    bool isVoiceCrossing(const NoteEvent& note) const;
-    
-    // Generation mode control
-    void setGenerateAbove(bool above) { generateAbove = above; }
-    
     // Note range control for dynamic scaling
     void setNoteRange(int lowestNote, int highestNote);
     int getLowestNote() const { return (int)pitchOffset; }
@@ -169,9 +164,6 @@ private:
     // Influence highlighting
     std::vector<Influence> influences;
     
-    // Generation mode
-    bool generateAbove = true; // Default to generating above
-    
     // Dynamic boundary tracking
     float noteDisappearanceX = 60.0f; // Dynamic right boundary where notes vanish
     bool resizedSinceLastFrame = false; // Flag for layout updates
@@ -183,9 +183,9 @@ void PianoRollGrid::drawNote(juce::Graphics& g, const NoteEvent& note, const juc
         // Input notes - use velocity-based color
         col = getDynamicVelocityColor((int)note.velocity);
     } else if (note.voice == 1) {
-        // Generated counterpoint notes - check for voice crossing first
-        if (isVoiceCrossing(note)) {
-            col = juce::Colours::red; // true overlap or crossing
+        // Generated counterpoint notes - red if the rule checker flagged a voice crossing
+        if (note.crossing) {
+            col = juce::Colours::red;
         } else {
             // Use velocity-based color for generated notes too
             col = getDynamicVelocityColor((int)note.velocity);
@@ -227,78 +227,6 @@ void PianoRollGrid::drawInfluences(juce::Graphics& g, const juce::Rectangle<floa
     }
 }
 
-bool PianoRollGrid::isVoiceCrossing(const NoteEvent& note) const
-{
-    // Only check voice crossing for generated notes (voice 1)
-    if (note.voice != 1) return false;
-    
-    // Find the corresponding input note (voice 0) that overlaps in time
-    for (const auto& inputNote : activeNotes)
-    {
-        if (inputNote.voice == 0 && inputNote.active)
-        {
-            // Check if notes overlap in time
-            bool timeOverlap = (note.startTime < (inputNote.endTime > 0 ? inputNote.endTime : currentTime) &&
-                               (note.endTime > 0 ? note.endTime : currentTime) > inputNote.startTime);
-            
-            if (timeOverlap)
-            {
-                // Check for voice crossing based on generation mode
-                bool voiceCrossing = false;
-                if (generateAbove)
-                {
-                    // When generating above, crossing occurs if generated note is below or equal to input
-                    voiceCrossing = (note.pitch <= inputNote.pitch);
-                }
-                else
-                {
-                    // When generating below, crossing occurs if generated note is above or equal to input
-                    voiceCrossing = (note.pitch >= inputNote.pitch);
-                }
-                
-                if (voiceCrossing)
-                {
-                    return true;
-                }
-            }
-        }
-    }
-    
-    // Also check finished notes for recent crossings
-    for (const auto& inputNote : finishedNotes)
-    {
-        if (inputNote.voice == 0)
-        {
-            // Check if notes overlap in time (with some tolerance for recent notes)
-            bool timeOverlap = (note.startTime < inputNote.endTime &&
-                               (note.endTime > 0 ? note.endTime : currentTime) > inputNote.startTime);
-            
-            if (timeOverlap)
-            {
-                // Check for voice crossing based on generation mode
-                bool voiceCrossing = false;
-                if (generateAbove)
-                {
-                    // When generating above, crossing occurs if generated note is below or equal to input
-                    voiceCrossing = (note.pitch <= inputNote.pitch);
-                }
-                else
-                {
-                    // When generating below, crossing occurs if generated note is above or equal to input
-                    voiceCrossing = (note.pitch >= inputNote.pitch);
-                }
-                
-                if (voiceCrossing)
-                {
-                    return true;
-                }
-            }
-        }
-    }
-    
-    return false;
-}
-
 juce::Colour PianoRollGrid::getDynamicVelocityColor(int velocity) const
 {
     return ::getDynamicVelocityColor(velocity);
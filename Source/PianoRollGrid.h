@@ -21,7 +21,6 @@ public:
     double timeWindow = 6.0;
     double pixelsPerSecond = 120.0;
     std::vector<Influence> influences;
-    bool generateAbove = true;
     float keyboardWidth = 60.0f; // Dynamic keyboard width for boundary calculations
 
     void paint (juce::Graphics& g) override;
@@ -30,6 +29,5 @@ private:
     void drawNotes(juce::Graphics& g, const juce::Rectangle<float>& roll);
     void drawNote(juce::Graphics& g, const NoteEvent& note, const juce::Rectangle<int>& area, double startTime);
     void drawInfluences(juce::Graphics& g, const juce::Rectangle<float>& roll);
-    bool isVoiceCrossing(const NoteEvent& note) const;
     juce::Colour getDynamicVelocityColor(int velocity) const;
 };
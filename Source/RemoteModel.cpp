@@ -0,0 +1,581 @@
+#include "RemoteModel.h"
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <thread>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #define POLYMUSE_REMOTE_MODEL 1
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <sys/mman.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#else
+ #define POLYMUSE_REMOTE_MODEL 0
+#endif
+
+using namespace RemoteModelProtocol;
+
+namespace
+{
+    constexpr juce::uint32 reconnectBackOffMs = 1000;
+
+    void fillUniform(float* probs, size_t n)
+    {
+        std::fill(probs, probs + n, 1.0f / (float)juce::jmax((size_t)1, n));
+    }
+}
+
+#if POLYMUSE_REMOTE_MODEL
+namespace
+{
+    constexpr int pollIntervalMs = 100;     // how often server threads look at shouldExit
+
+    int sendFlags()
+    {
+       #ifdef MSG_NOSIGNAL
+        return MSG_NOSIGNAL;
+       #else
+        return 0;
+       #endif
+    }
+
+    int openSocket()
+    {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+       #ifdef SO_NOSIGPIPE
+        if (fd >= 0)
+        {
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        }
+       #endif
+        return fd;
+    }
+
+    bool makeAddress(const juce::String& path, sockaddr_un& addr)
+    {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        const auto utf8 = path.toRawUTF8();
+        if (std::strlen(utf8) >= sizeof(addr.sun_path))
+            return false;
+        std::strcpy(addr.sun_path, utf8);
+        return true;
+    }
+
+    // 1 if readable, 0 on timeout, -1 on error
+    int waitReadable(int fd, int timeoutMs)
+    {
+        pollfd p { fd, POLLIN, 0 };
+        for (;;)
+        {
+            const int r = ::poll(&p, 1, timeoutMs);
+            if (r < 0 && errno == EINTR)
+                continue;
+            return r < 0 ? -1 : (r == 0 ? 0 : 1);
+        }
+    }
+
+    // The object has to cover a whole block: mapping past its end would not fail here,
+    // the first touch of the missing pages would (SIGBUS)
+    Block* mapBlock(int shmFd)
+    {
+        struct stat st;
+        if (::fstat(shmFd, &st) != 0 || st.st_size < (off_t)sizeof(Block))
+            return nullptr;
+
+        void* p = ::mmap(nullptr, sizeof(Block), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        return p == MAP_FAILED ? nullptr : static_cast<Block*>(p);
+    }
+
+    // Scores one slot in place. The client owns the slot's layout, so every range is
+    // checked against the slot before the model sees it.
+    void serveSlot(ModelBridge& model, Slot& s)
+    {
+        std::array<ScoreRequest, maxRequests> requests;
+        const juce::uint32 n = s.numRequests;
+        juce::uint32 totalCandidates = 0;
+        bool valid = n <= (juce::uint32)maxRequests;
+
+        for (juce::uint32 i = 0; valid && i < n; ++i)
+        {
+            const Range r = s.requests[i];
+            valid = r.contextStart <= (juce::uint32)maxNotes && r.contextSize <= (juce::uint32)maxNotes - r.contextStart
+                 && r.candidateStart == totalCandidates && r.candidateSize <= (juce::uint32)maxCandidates - r.candidateStart;
+            if (valid)
+            {
+                requests[i] = { { s.context + r.contextStart, r.contextSize },
+                                { s.candidates + r.candidateStart, r.candidateSize } };
+                totalCandidates += r.candidateSize;
+            }
+        }
+
+        if (!valid)
+        {
+            s.status = 1;
+            return;
+        }
+
+        model.scoreBatch({ requests.data(), n }, s.keyRoot, s.isMajor != 0, { s.probs, totalCandidates });
+        s.status = 0;
+    }
+
+    void serveConnection(int fd, int connectionIndex, std::unique_ptr<ModelBridge> model,
+                         const std::function<bool()>& shouldExit)
+    {
+        const juce::String name = "/polymuse-" + juce::String((int)::getpid()) + "-" + juce::String(connectionIndex);
+        const int shmFd = ::shm_open(name.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (shmFd < 0)
+        {
+            ::close(fd);
+            return;
+        }
+
+        Block* block = ::ftruncate(shmFd, (off_t)sizeof(Block)) == 0 ? mapBlock(shmFd) : nullptr;
+        ::close(shmFd);
+
+        Hello hello {};
+        hello.magic = magic;
+        hello.version = version;
+        hello.blockBytes = (juce::uint32)sizeof(Block);
+        name.copyToUTF8(hello.shmName, sizeof(hello.shmName));
+
+        juce::uint32 ack = 1;
+        if (block != nullptr && model != nullptr)
+        {
+            block->magic = magic;
+            block->version = version;
+            block->slotCount = (juce::uint32)numSlots;
+            block->contextWindow = (juce::uint32)juce::jlimit(1, maxNotes, model->contextWindow());
+
+            if (sendAll(fd, &hello, sizeof(hello)))
+                receiveAll(fd, &ack, sizeof(ack), 2000);
+        }
+
+        // Mapped by the client (or never will be): the name is no longer needed
+        ::shm_unlink(name.toRawUTF8());
+
+        while (ack == 0 && !shouldExit())
+        {
+            const int ready = waitReadable(fd, pollIntervalMs);
+            if (ready == 0)
+                continue;
+
+            juce::int32 slot = -1;
+            if (ready < 0 || !receiveAll(fd, &slot, sizeof(slot), 1000) || slot < 0 || slot >= numSlots)
+                break;
+
+            serveSlot(*model, block->slots[slot]);
+
+            if (!sendAll(fd, &slot, sizeof(slot)))
+                break;
+        }
+
+        if (block != nullptr)
+            ::munmap(block, sizeof(Block));
+        ::close(fd);
+    }
+}
+
+bool RemoteModelProtocol::sendAll(int fd, const void* data, size_t size)
+{
+    auto* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t sent = ::send(fd, p, size, sendFlags());
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        p += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool RemoteModelProtocol::receiveAll(int fd, void* data, size_t size, int timeoutMs)
+{
+    auto* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        if (waitReadable(fd, timeoutMs) <= 0)
+            return false;
+
+        const ssize_t got = ::recv(fd, p, size, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        p += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+juce::String RemoteModelProtocol::getDefaultSocketPath()
+{
+    const auto runtimeDir = juce::SystemStats::getEnvironmentVariable("XDG_RUNTIME_DIR", {});
+    if (runtimeDir.isNotEmpty())
+        return runtimeDir + "/polymuse-model.sock";
+    return "/tmp/polymuse-model-" + juce::String((int)::getuid()) + ".sock";
+}
+
+bool RemoteModelProtocol::serve(const juce::String& socketPath, std::function<std::unique_ptr<ModelBridge>()> makeModel,
+                                std::function<bool()> shouldExit)
+{
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+        return false;
+
+    const int listenFd = openSocket();
+    if (listenFd < 0)
+        return false;
+
+    // A socket file left behind by a server that died would make bind fail
+    ::unlink(addr.sun_path);
+    if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+        || ::chmod(addr.sun_path, 0600) != 0 || ::listen(listenFd, 8) != 0)
+    {
+        ::close(listenFd);
+        return false;
+    }
+
+    std::list<std::thread> connections;
+    int connectionIndex = 0;
+    bool ok = true;
+
+    while (!shouldExit())
+    {
+        const int ready = waitReadable(listenFd, pollIntervalMs);
+        if (ready == 0)
+            continue;
+
+        const int fd = ready > 0 ? ::accept(listenFd, nullptr, nullptr) : -1;
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            ok = false;
+            break;
+        }
+
+        connections.emplace_back(serveConnection, fd, connectionIndex++, makeModel(), std::cref(shouldExit));
+    }
+
+    ::close(listenFd);
+    ::unlink(addr.sun_path);
+    for (auto& t : connections)
+        t.join();
+    return ok;
+}
+
+//==============================================================================
+bool RemoteModel::open()
+{
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+        return false;
+
+    const int fd = openSocket();
+    if (fd < 0)
+        return false;
+
+    Hello hello {};
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+        || !receiveAll(fd, &hello, sizeof(hello), timeoutMs)
+        || hello.magic != magic || hello.version != version || hello.blockBytes != sizeof(Block))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    hello.shmName[sizeof(hello.shmName) - 1] = 0;
+    const int shmFd = ::shm_open(hello.shmName, O_RDWR, 0);
+    Block* mapped = shmFd >= 0 ? mapBlock(shmFd) : nullptr;
+    if (shmFd >= 0)
+        ::close(shmFd);
+
+    const juce::uint32 ack = 0;
+    if (mapped == nullptr || mapped->magic != magic || mapped->slotCount != (juce::uint32)numSlots
+        || !sendAll(fd, &ack, sizeof(ack)))
+    {
+        if (mapped != nullptr)
+            ::munmap(mapped, sizeof(Block));
+        ::close(fd);
+        return false;
+    }
+
+    socketFd = fd;
+    block = mapped;
+    blockBytes = sizeof(Block);
+    window = (int)juce::jlimit((juce::uint32)1, (juce::uint32)maxNotes, mapped->contextWindow);
+    broken = false;
+    return true;
+}
+
+void RemoteModel::close()
+{
+    if (block != nullptr)
+        ::munmap(block, blockBytes);
+    if (socketFd >= 0)
+        ::close(socketFd);
+
+    block = nullptr;
+    blockBytes = 0;
+    socketFd = -1;
+    for (auto& done : slotDone)
+        done = false;
+}
+
+bool RemoteModel::waitForSlot(int slot)
+{
+    const juce::uint32 deadline = juce::Time::getMillisecondCounter() + (juce::uint32)timeoutMs;
+
+    for (;;)
+    {
+        if (slotDone[(size_t)slot].exchange(false, std::memory_order_acq_rel))
+            return true;
+
+        const juce::uint32 now = juce::Time::getMillisecondCounter();
+        if (broken || now >= deadline)
+            return false;
+
+        // One waiter at a time reads replies off the socket and hands out the ones that
+        // are not its own
+        if (readerLock.tryEnter())
+        {
+            juce::int32 done = -1;
+            const bool ok = slotDone[(size_t)slot].load(std::memory_order_acquire)
+                         || receiveAll(socketFd, &done, sizeof(done), (int)(deadline - now));
+            readerLock.exit();
+
+            if (done == slot)
+                return true;
+            if (!ok || done >= numSlots)
+            {
+                // A timeout may leave half an index in the stream, so the connection is done for
+                broken = true;
+                for (auto& e : slotEvents)
+                    e.signal();
+                return false;
+            }
+            if (done >= 0)
+            {
+                slotDone[(size_t)done].store(true, std::memory_order_release);
+                slotEvents[(size_t)done].signal();
+            }
+        }
+        else
+        {
+            slotEvents[(size_t)slot].wait(1.0);
+        }
+    }
+}
+
+#else
+bool RemoteModelProtocol::sendAll(int, const void*, size_t) { return false; }
+bool RemoteModelProtocol::receiveAll(int, void*, size_t, int) { return false; }
+juce::String RemoteModelProtocol::getDefaultSocketPath() { return {}; }
+bool RemoteModelProtocol::serve(const juce::String&, std::function<std::unique_ptr<ModelBridge>()>, std::function<bool()>) { return false; }
+
+bool RemoteModel::open() { return false; }
+void RemoteModel::close() {}
+bool RemoteModel::waitForSlot(int) { return false; }
+#endif
+
+//==============================================================================
+RemoteModel::RemoteModel(juce::String path, int timeout)
+    : socketPath(std::move(path)), timeoutMs(timeout)
+{
+}
+
+RemoteModel::~RemoteModel()
+{
+    close();
+}
+
+std::unique_ptr<RemoteModel> RemoteModel::connect(const juce::String& socketPath, int timeoutMs)
+{
+    std::unique_ptr<RemoteModel> model(new RemoteModel(socketPath, timeoutMs));
+    if (!model->open())
+        return nullptr;
+    return model;
+}
+
+bool RemoteModel::ensureConnected()
+{
+    {
+        const juce::ScopedReadLock rl(connectionLock);
+        if (block != nullptr && !broken)
+            return true;
+    }
+
+    const juce::ScopedWriteLock wl(connectionLock);
+    if (block != nullptr && !broken)
+        return true;
+
+    close();
+    const juce::uint32 now = juce::Time::getMillisecondCounter();
+    if (now - lastFailureMs < reconnectBackOffMs)
+        return false;
+    if (open())
+        return true;
+    lastFailureMs = now;
+    return false;
+}
+
+int RemoteModel::acquireSlot()
+{
+    // Callers beyond numSlots at once spin until a slot frees up
+    for (int attempt = 0;; ++attempt)
+    {
+        for (int i = 0; i < numSlots; ++i)
+        {
+            bool expected = false;
+            if (slotBusy[(size_t)i].compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                slotEvents[(size_t)i].reset();
+                return i;
+            }
+        }
+        if (attempt > 0)
+            std::this_thread::yield();
+    }
+}
+
+bool RemoteModel::roundTrip(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor, float* probsOut)
+{
+    const int index = acquireSlot();
+    auto& s = block->slots[index];
+    s.keyRoot = keyRoot;
+    s.isMajor = isMajor ? 1 : 0;
+    s.numRequests = (juce::uint32)requests.size();
+    s.status = 1;
+
+    juce::uint32 notes = 0, candidates = 0;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const auto& req = requests[i];
+        const size_t used = juce::jmin(req.contextSize(), (size_t)window);
+        if (req.isMasked())
+            req.resolvedContext({ s.context + notes, used });
+        else
+            std::copy(req.context.end() - (std::ptrdiff_t)used, req.context.end(), s.context + notes);
+        std::copy(req.candidatePitches.begin(), req.candidatePitches.end(), s.candidates + candidates);
+        s.requests[i] = { notes, (juce::uint32)used, candidates, (juce::uint32)req.candidatePitches.size() };
+        notes += (juce::uint32)used;
+        candidates += (juce::uint32)req.candidatePitches.size();
+    }
+
+    const juce::int32 slot = index;
+    bool ok;
+    {
+        const juce::ScopedLock sl(sendLock);
+        ok = sendAll(socketFd, &slot, sizeof(slot));
+    }
+
+    ok = ok && waitForSlot(index) && s.status == 0;
+    if (ok)
+        std::copy(s.probs, s.probs + candidates, probsOut);
+    else
+        broken = true;
+
+    slotBusy[(size_t)index].store(false, std::memory_order_release);
+    return ok;
+}
+
+void RemoteModel::scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                             std::span<float> probsOut)
+{
+    jassert(totalCandidates(requests) <= probsOut.size());
+    const bool connected = ensureConnected();
+    const juce::ScopedReadLock rl(connectionLock);
+    bool ok = connected && block != nullptr;
+
+    // Pack as many requests as fit into each slot
+    size_t first = 0, offset = 0;
+    while (first < requests.size())
+    {
+        size_t last = first, notes = 0, candidates = 0;
+        while (last < requests.size() && last - first < (size_t)maxRequests)
+        {
+            const size_t n = juce::jmin(requests[last].contextSize(), (size_t)window);
+            const size_t k = requests[last].candidatePitches.size();
+            if (notes + n > (size_t)maxNotes || candidates + k > (size_t)maxCandidates)
+                break;
+            notes += n;
+            candidates += k;
+            ++last;
+        }
+
+        // A single request too big for a slot: more candidates than any line can have
+        jassert(last > first);
+        if (last == first)
+        {
+            fillUniform(probsOut.data() + offset, requests[first].candidatePitches.size());
+            offset += requests[first].candidatePitches.size();
+            ++first;
+            continue;
+        }
+
+        ok = ok && roundTrip(requests.subspan(first, last - first), keyRoot, isMajor, probsOut.data() + offset);
+        if (!ok)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                fillUniform(probsOut.data() + offset, requests[i].candidatePitches.size());
+                offset += requests[i].candidatePitches.size();
+            }
+        }
+        else
+        {
+            offset += candidates;
+        }
+        first = last;
+    }
+}
+
+void RemoteModel::scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                                     int keyRoot, bool isMajor, std::span<float> probsOut)
+{
+    const ScoreRequest request { context, candidatePitches };
+    scoreBatch({ &request, 1 }, keyRoot, isMajor, probsOut);
+}
+
+std::vector<Rationale> RemoteModel::scoreCandidates(const std::vector<ContextNote>& ctx,
+                                                    const std::vector<int>& candidates,
+                                                    int keyRoot, bool isMajor)
+{
+    std::vector<float> probs(candidates.size());
+    scoreProbabilities(ctx, candidates, keyRoot, isMajor, probs);
+
+    // Only probabilities cross the process boundary; the rationale points at the most
+    // recent notes, as the in-process backends do
+    std::vector<Rationale> out;
+    out.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        Rationale r;
+        r.candidatePitch = candidates[i];
+        r.prob = probs[i];
+        r.summary = isConnected() ? "Remote model: scored by the model server."
+                                  : "Remote model: server unavailable, all candidates equal.";
+        for (int k = 0; k < 5 && k < (int)ctx.size(); ++k)
+        {
+            const auto& note = ctx[ctx.size() - 1 - (size_t)k];
+            r.influences.push_back({ note.pitch, note.startSec, note.endSec, 1.0f - 0.18f * (float)k });
+        }
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+std::unique_ptr<ModelBridge> ModelBridge::createRemote(const juce::String& socketPath)
+{
+    return RemoteModel::connect(socketPath);
+}
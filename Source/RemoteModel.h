@@ -0,0 +1,123 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <span>
+#include <type_traits>
+#include "ModelBridge.h"
+
+// Wire format between RemoteModel and a model server (Tools/PolyMuseModelServer).
+//
+// The server listens on a Unix domain socket. For each connection it creates a POSIX
+// shared-memory block holding a ring of request slots and sends its name in a Hello;
+// the client maps it and acks, after which the server unlinks the name. From then on
+// only slot indices cross the socket: the client fills a slot in place and writes its
+// index, the server scores straight out of the slot into the slot's probs and writes
+// the index back. The socket write/read pair orders the shared-memory accesses.
+namespace RemoteModelProtocol
+{
+    constexpr juce::uint32 magic = 0x4d524d50;   // "PMRM"
+    constexpr juce::uint32 version = 1;
+    constexpr int numSlots = 8;
+    constexpr int maxRequests = 32;              // per slot
+    constexpr int maxNotes = 256;                // context notes per slot, all requests together
+    constexpr int maxCandidates = 256;           // candidates per slot, all requests together
+
+    static_assert(std::is_trivially_copyable_v<ContextNote> && sizeof(ContextNote) == 24);
+
+    struct Range
+    {
+        juce::uint32 contextStart, contextSize;
+        juce::uint32 candidateStart, candidateSize;
+    };
+
+    struct Slot
+    {
+        juce::int32 keyRoot;
+        juce::int32 isMajor;
+        juce::uint32 numRequests;
+        juce::uint32 status;                     // 0 = scored
+        Range requests[maxRequests];
+        ContextNote context[maxNotes];
+        juce::int32 candidates[maxCandidates];
+        float probs[maxCandidates];
+    };
+
+    struct Block
+    {
+        juce::uint32 magic, version, slotCount, contextWindow;
+        Slot slots[numSlots];
+    };
+
+    struct Hello
+    {
+        juce::uint32 magic, version;
+        juce::uint32 blockBytes;
+        char shmName[52];
+    };
+    static_assert(sizeof(Hello) == 64);
+
+    // Blocking socket helpers; false on error, end of stream or timeout (ms, -1 = none)
+    bool sendAll(int fd, const void* data, size_t size);
+    bool receiveAll(int fd, void* data, size_t size, int timeoutMs);
+
+    juce::String getDefaultSocketPath();
+
+    // Server side: listen on socketPath and serve each connection on its own thread with a
+    // model from makeModel. Returns when shouldExit() turns true (polled) or on error.
+    bool serve(const juce::String& socketPath, std::function<std::unique_ptr<ModelBridge>()> makeModel,
+               std::function<bool()> shouldExit);
+}
+
+// ModelBridge that forwards scoring to a model server process, so a heavy model that
+// crashes or loads slowly cannot take the GUI with it. Calls from several threads each
+// take their own slot and run concurrently. If the server stops answering (timeout),
+// the call returns uniform probabilities and the connection is dropped; the next call
+// after a short back-off tries to reconnect.
+class RemoteModel : public ModelBridge {
+public:
+    ~RemoteModel() override;
+
+    static std::unique_ptr<RemoteModel> connect(const juce::String& socketPath, int timeoutMs = 200);
+
+    std::vector<Rationale> scoreCandidates(const std::vector<ContextNote>& context,
+                                           const std::vector<int>& candidatePitches,
+                                           int keyRoot, bool isMajor) override;
+    void scoreProbabilities(std::span<const ContextNote> context, std::span<const int> candidatePitches,
+                            int keyRoot, bool isMajor, std::span<float> probsOut) override;
+    void scoreBatch(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor,
+                    std::span<float> probsOut) override;
+
+    int contextWindow() const override { return window; }
+    bool isThreadSafe() const override { return true; }
+
+    bool isConnected() const { return block != nullptr && !broken; }
+
+private:
+    RemoteModel(juce::String socketPath, int timeoutMs);
+
+    bool open();
+    void close();
+    bool ensureConnected();
+    // Packs requests into one slot and round-trips it; false if the server failed
+    bool roundTrip(std::span<const ScoreRequest> requests, int keyRoot, bool isMajor, float* probsOut);
+    int acquireSlot();
+    bool waitForSlot(int slot);
+
+    const juce::String socketPath;
+    const int timeoutMs;
+    int window = 32;
+
+    juce::ReadWriteLock connectionLock;      // write-held while (re)connecting
+    int socketFd = -1;
+    RemoteModelProtocol::Block* block = nullptr;
+    size_t blockBytes = 0;
+    juce::uint32 lastFailureMs = 0;
+    std::atomic<bool> broken { false };
+
+    std::array<std::atomic<bool>, RemoteModelProtocol::numSlots> slotBusy {};
+    std::array<std::atomic<bool>, RemoteModelProtocol::numSlots> slotDone {};
+    std::array<juce::WaitableEvent, RemoteModelProtocol::numSlots> slotEvents;
+    juce::CriticalSection sendLock, readerLock;
+};
@@ -1,174 +1,428 @@
 #include "RuleChecker.h"
-#include "CounterpointEngine.h"  // For NotePair definition
+#include "IntervalTables.h"
+#include "SimdTarget.h"
 #include <cmath>
 
 static juce::String intervalName(int semitones)
 {
-    semitones = (semitones % 12 + 12) % 12;
-    switch (semitones)
+    return IntervalTables::intervalNameFor(semitones);
+}
+
+namespace
+{
+    // What a batch shares: the input note and the pair before it
+    struct BatchContext
     {
-        case 0:  return "unison";
-        case 1:  return "minor 2nd";
-        case 2:  return "major 2nd";
-        case 3:  return "minor 3rd";
-        case 4:  return "major 3rd";
-        case 5:  return "perfect 4th";
-        case 6:  return "tritone";
-        case 7:  return "perfect 5th";
-        case 8:  return "minor 6th";
-        case 9:  return "major 6th";
-        case 10: return "minor 7th";
-        case 11: return "major 7th";
-        default: return "unknown";
+        int inputPitch = 0;
+        int prevGen = 0;
+        int motionIn = 0;          // 0 also when there is no previous pair: nothing moves in parallel
+        bool prevPerfect = false;
+        bool prevOctave = false;
+    };
+
+    // previous is the pair before the candidates, nullptr at the start of a phrase
+    BatchContext makeBatchContext(const NotePair* previous, int inputPitch)
+    {
+        BatchContext b;
+        b.inputPitch = inputPitch;
+        if (previous != nullptr)
+        {
+            const NotePair& prev = *previous;
+            const uint8_t f = IntervalTables::flags(prev.generatedPitch - prev.inputPitch);
+            b.prevGen = prev.generatedPitch;
+            b.motionIn = IntervalTables::motion(prev.inputPitch, inputPitch);
+            b.prevPerfect = (f & IntervalTables::Perfect) != 0;
+            b.prevOctave = (f & IntervalTables::Octave) != 0;
+        }
+        return b;
     }
-}
 
-static int mod12(int x){ x%=12; if(x<0) x+=12; return x; }
+    juce::uint32 lowBits(int n) { return n >= 32 ? ~0u : (1u << n) - 1u; }
 
-bool RuleChecker::isPerfect(int s) const { s=std::abs(s)%12; return s==0 || s==7; }
-bool RuleChecker::isConsonant(int s) const { s=std::abs(s)%12; return s==0||s==3||s==4||s==7||s==8||s==9; }
+    CandidateMasks batchScalar(const BatchContext& b, const int* cands, int n, float* scores)
+    {
+        CandidateMasks m;
+        for (int i = 0; i < n; ++i)
+        {
+            const uint8_t f = IntervalTables::flags(cands[i] - b.inputPitch);
+            const bool similar = b.motionIn != 0 && IntervalTables::motion(b.prevGen, cands[i]) == b.motionIn;
+            const bool perfect = (f & IntervalTables::Perfect) != 0;
+            const bool dissonant = (f & IntervalTables::Consonant) == 0;
+            const bool parallel = b.prevPerfect && perfect && similar;
+            const bool octave = parallel && b.prevOctave && (f & IntervalTables::Octave) != 0;
 
-bool RuleChecker::isPerfectInterval(int semitones) const
-{
-    int interval = semitones % 12;
-    return (interval == 0 || interval == 7); // Unison or fifth/octave equivalence
-}
+            const juce::uint32 bit = 1u << i;
+            if (dissonant) m.dissonant |= bit;
+            if (octave) m.parallelOctave |= bit;
+            else if (parallel) m.parallelFifth |= bit;
+            if (!b.prevPerfect && perfect && similar) m.hiddenPerfect |= bit;
 
-std::vector<Violation> RuleChecker::evaluate(const std::vector<ExplanationNotePair>& H,
-                                             int inP, int genP, double t, bool inPhrase) const
-{
-    std::vector<Violation> out;
+            float score = 1.0f;
+            if (dissonant) score -= 0.3f;
+            if (parallel) score -= 0.3f;
+            scores[i] = juce::jlimit(0.0f, 1.0f, score);
+        }
+        m.legal = ~(m.dissonant | m.parallelFifth | m.parallelOctave) & lowBits(n);
+        return m;
+    }
+
+   #if JUCE_INTEL
+    // Interval classes as bit sets, so a class is tested with one variable shift
+    constexpr juce::uint32 consonantClasses = (1u << 0) | (1u << 3) | (1u << 4) | (1u << 7) | (1u << 8) | (1u << 9);
+    constexpr juce::uint32 perfectClasses = (1u << 0) | (1u << 7);
+
+    // a / 12 as a multiply and shift; exact over every MIDI interval
+    constexpr int div12(int a) { return (a * 2731) >> 15; }
+    static_assert([] {
+        for (int a = 0; a <= IntervalTables::maxDiff; ++a)
+            if (div12(a) != a / 12)
+                return false;
+        return true;
+    }());
 
-    // --- Dissonance Check ---
-    if (!isConsonant(genP - inP))
+    // One bit per all-ones lane
+    POLYMUSE_TARGET_AVX2
+    inline juce::uint32 laneBits(__m256i v)
     {
-        int interval = std::abs(genP - inP) % 12;
-        juce::String intervalName = ::intervalName(interval);
-        out.push_back({ViolationKind::DissonanceOnStrongBeat, 1.0f, genP, 0, inP, t,
-                       "Dissonant interval: " + intervalName + " is not allowed in strict counterpoint.",
-                       "Use consonant intervals: unison, 3rd, 4th, 5th, 6th, or octave.", 0.7f});
+        return (juce::uint32)_mm256_movemask_ps(_mm256_castsi256_ps(v));
     }
 
-    // --- Historical Checks ---
-    if (H.size() >= 1)
+    // Eight candidates per step: interval class, consonance, motion and the combined
+    // score are computed across lanes, then each rule's lanes are packed into its mask
+    POLYMUSE_TARGET_AVX2
+    CandidateMasks batchAvx2(const BatchContext& b, const int* cands, int n, float* scores)
     {
-        auto [prevIn, prevGen, prevT] = H.back();
+        const __m256i input = _mm256_set1_epi32(b.inputPitch);
+        const __m256i prevGen = _mm256_set1_epi32(b.prevGen);
+        const __m256i motionIn = _mm256_set1_epi32(b.motionIn);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i prevPerfect = _mm256_set1_epi32(b.prevPerfect ? -1 : 0);
+        const __m256i prevOctave = _mm256_set1_epi32(b.prevOctave ? -1 : 0);
+        const __m256i moving = _mm256_set1_epi32(b.motionIn != 0 ? -1 : 0);
+        const __m256 penalty = _mm256_set1_ps(0.3f);
 
-        int prevInt = std::abs(prevGen - prevIn);
-        int currInt = std::abs(genP - inP);
-        int dirIn = (inP > prevIn) ? 1 : (inP < prevIn ? -1 : 0);
-        int dirGen = (genP > prevGen) ? 1 : (genP < prevGen ? -1 : 0);
-
-        // Parallel perfects
-        if (isPerfect(prevInt) && isPerfect(currInt) && dirIn == dirGen && dirIn != 0)
+        CandidateMasks m;
+        for (int start = 0; start < n; start += 8)
         {
-            juce::String prevIntervalName = ::intervalName(prevInt);
-            juce::String currIntervalName = ::intervalName(currInt);
-            
-            // Determine if this is a parallel 5th or parallel octave
-            ViolationKind violationKind;
-            if ((prevInt == 0 || prevInt == 12) && (currInt == 0 || currInt == 12))
-                violationKind = ViolationKind::ParallelOctave;
-            else if ((prevInt == 7 || prevInt == 19) && (currInt == 7 || currInt == 19))
-                violationKind = ViolationKind::ParallelFifth;
-            else
-                violationKind = ViolationKind::ParallelFifth; // Default fallback
-            
-            out.push_back({violationKind, 1.0f, genP, 0, inP, t,
-                           "Parallel motion between perfect intervals: " + prevIntervalName + " → " + currIntervalName + ".",
-                           "Avoid parallel 5ths/8ves; use contrary or oblique motion instead.", 0.9f});
+            const int count = juce::jmin(8, n - start);
+            const __m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lanes);
+            const __m256i c = _mm256_maskload_epi32(cands + start, active);
+
+            const __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(c, input));
+            const __m256i q = _mm256_srli_epi32(_mm256_mullo_epi32(d, _mm256_set1_epi32(2731)), 15);
+            const __m256i cls = _mm256_sub_epi32(d, _mm256_mullo_epi32(q, _mm256_set1_epi32(12)));
+
+            const __m256i consonant = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)consonantClasses), cls), one), one);
+            const __m256i perfect = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)perfectClasses), cls), one), one);
+            const __m256i dissonant = _mm256_cmpeq_epi32(consonant, zero);
+
+            // sign(c - prevGen) is the generated voice's motion
+            const __m256i motionGen = _mm256_sign_epi32(one, _mm256_sub_epi32(c, prevGen));
+            const __m256i similar = _mm256_and_si256(moving, _mm256_cmpeq_epi32(motionGen, motionIn));
+            const __m256i approach = _mm256_and_si256(perfect, similar);
+            const __m256i parallel = _mm256_and_si256(approach, prevPerfect);
+            const __m256i hidden = _mm256_andnot_si256(prevPerfect, approach);
+            const __m256i octave = _mm256_and_si256(_mm256_and_si256(parallel, prevOctave), _mm256_cmpeq_epi32(cls, zero));
+
+            // Same subtractions as evaluateScore, so the scores match bit for bit
+            __m256 s = _mm256_set1_ps(1.0f);
+            s = _mm256_sub_ps(s, _mm256_and_ps(_mm256_castsi256_ps(dissonant), penalty));
+            s = _mm256_sub_ps(s, _mm256_and_ps(_mm256_castsi256_ps(parallel), penalty));
+            _mm256_maskstore_ps(scores + start, active, s);
+
+            const juce::uint32 valid = lowBits(count);
+            m.dissonant |= (laneBits(dissonant) & valid) << start;
+            m.parallelOctave |= (laneBits(octave) & valid) << start;
+            m.parallelFifth |= (laneBits(_mm256_andnot_si256(octave, parallel)) & valid) << start;
+            m.hiddenPerfect |= (laneBits(hidden) & valid) << start;
         }
+        m.legal = ~(m.dissonant | m.parallelFifth | m.parallelOctave) & lowBits(n);
+        return m;
+    }
+   #endif
+
+    using BatchFn = CandidateMasks (*)(const BatchContext&, const int*, int, float*);
+
+    struct BatchKernel
+    {
+        BatchFn fn;
+        const char* name;
+    };
 
-        // Hidden perfects
-        if (!isPerfect(prevInt) && isPerfect(currInt) && dirIn == dirGen)
+    const BatchKernel& batchKernel()
+    {
+        static const BatchKernel kernel = [] () -> BatchKernel {
+           #if JUCE_INTEL
+            if (juce::SystemStats::hasAVX2())
+                return { batchAvx2, "avx2" };
+           #endif
+            return { batchScalar, "scalar" };
+        }();
+        return kernel;
+    }
+}
+
+std::span<const RulePreset> RuleChecker::presets()
+{
+    static constexpr RulePreset registry[] = {
+        makeRulePreset<RuleSets::Strict>("strict", "Species counterpoint: every rule"),
+        makeRulePreset<RuleSets::Free>("free", "Free counterpoint: no dissonance, hidden-fifth or crossing rules"),
+        makeRulePreset<RuleSets::Parallels>("parallels", "Parallel fifths and octaves only"),
+    };
+    static_assert(RuleSets::Strict::maxViolations <= maxPairViolations
+                  && RuleSets::Free::maxViolations <= maxPairViolations
+                  && RuleSets::Parallels::maxViolations <= maxPairViolations);
+    return registry;
+}
+
+bool RuleChecker::setPreset(const juce::String& name)
+{
+    for (const auto& p : presets())
+    {
+        if (name == p.name)
         {
-            juce::String prevIntervalName = ::intervalName(prevInt);
-            juce::String currIntervalName = ::intervalName(currInt);
-            out.push_back({ViolationKind::HiddenFifthOctave, 1.0f, genP, 0, inP, t,
-                           "Hidden/direct motion to perfect interval: " + prevIntervalName + " → " + currIntervalName + ".",
-                           "Avoid approaching perfect intervals in similar motion; use contrary motion.", 0.6f});
+            preset = p;
+            return true;
         }
     }
+    return false;
+}
+
+void RuleChecker::setPreset(const RulePreset& custom)
+{
+    jassert(custom.maxViolations <= maxPairViolations);
+    preset = custom;
+}
 
-    // --- Final note rules (if this is the last bar) ---
-    if (!inPhrase && H.size() > 4)   // simple heuristic for phrase ending
+bool RuleChecker::isPerfect(int s) const { return IntervalTables::isPerfect(s); }
+bool RuleChecker::isConsonant(int s) const { return IntervalTables::isConsonant(s); }
+
+bool RuleChecker::isPerfectInterval(int semitones) const
+{
+    return IntervalTables::isPerfect(semitones); // Unison or fifth/octave equivalence
+}
+
+void MelodicState::advance(int pitch)
+{
+    if (lastPitch >= 0)
     {
-        if (!isPerfect(genP - inP))
-            out.push_back({ViolationKind::Other, 1.0f, genP, 0, inP, t,
-                           "Final sonority should be perfect (1 or 8).",
-                           "End on a perfect consonance.", 0.5f});
+        // A step or a change of direction ends the run of leaps
+        const int move = pitch - lastPitch;
+        const int direction = move > 0 ? 1 : (move < 0 ? -1 : 0);
+        const bool leap = std::abs(move) > 2;
+        leapRun = leap ? std::abs(move) + (direction == leapDirection ? leapRun : 0) : 0;
+        leapDirection = leap ? direction : 0;
     }
 
-    return out;
+    lowest = juce::jmin(lowest, pitch);
+    highest = juce::jmax(highest, pitch);
+    lastPitch = pitch;
 }
 
-std::vector<Violation> RuleChecker::evaluate(const std::vector<NotePair>& H,
-                                             int inP, int genP, double t) const
+std::vector<Violation> RuleChecker::evaluate(const TimelineView& H,
+                                             int inP, int genP, double t, bool inPhrase) const
 {
-    std::vector<Violation> out;
+    MelodicState line;
+    for (const auto& note : H.generated)
+        line.advance(note.pitch);
 
-    int interval = std::abs(genP - inP) % 12;
-    auto name = intervalName(interval);
-    bool isConsonant = (interval == 0 || interval == 3 || interval == 4 ||
-                        interval == 7 || interval == 8 || interval == 9);
+    PairContext context;
+    context.isFinal = !inPhrase && H.size() > 4;   // simple heuristic for phrase ending
+    context.generated = &line;
 
-    // Always push a result (so current interval always visible)
-    if (isConsonant)
-        out.push_back({ViolationKind::Consonance, 0.0f, genP, -1, inP, t,
-                       "Consonant interval: " + name + " is acceptable.", "", 0.0f});
-    else
-        out.push_back({ViolationKind::DissonanceOnStrongBeat, 1.0f, genP, -1, inP, t,
-                       "Dissonant interval: " + name + " is not allowed in strict counterpoint.", 
-                       "Use consonant intervals: unison, 3rd, 4th, 5th, 6th, or octave.", 1.0f});
-
-    // --- Parallel fifths/octaves check ---
-    if (H.size() >= 2)
+    const NotePair previous = H.empty() ? NotePair() : H.back();
+    Violation found[maxPairViolations];
+    const int n = evaluatePair(H.empty() ? nullptr : &previous, { inP, genP, t }, context, found);
+    return { found, found + n };
+}
+
+int RuleChecker::evaluatePair(const NotePair* previous, const NotePair& current, const PairContext& context,
+                              Violation* out) const
+{
+    // Worked out once for every rule of the preset
+    SonorityFacts f;
+    f.current = current;
+    f.diff = current.generatedPitch - current.inputPitch;
+    f.interval = std::abs(f.diff);
+    f.flags = IntervalTables::flags(f.diff);
+    f.voiceOrder = context.voiceOrder;
+    f.isFinal = context.isFinal;
+
+    if (previous != nullptr)
     {
-        const NotePair& prev = H[H.size() - 2];
+        f.prevGen = previous->generatedPitch;
+        f.prevDiff = f.prevGen - previous->inputPitch;
+        f.prevInterval = std::abs(f.prevDiff);
+        f.moveIn = current.inputPitch - previous->inputPitch;
+        f.moveGen = current.generatedPitch - f.prevGen;
+        f.motion = IntervalTables::motionViolations(previous->inputPitch, f.prevGen,
+                                                    current.inputPitch, current.generatedPitch);
+    }
 
-        int prevInt = std::abs(prev.generatedPitch - prev.inputPitch) % 12;
-        int currInt = std::abs(genP - inP) % 12;
+    // Each given line moves on whether or not the preset judges it
+    auto advanceLine = [](MelodicState* line, int pitch) {
+        LineFacts facts;
+        if (line == nullptr)
+            return facts;
 
-        int motionIn  = (inP  > prev.inputPitch)   ? 1 : (inP  < prev.inputPitch  ? -1 : 0);
-        int motionGen = (genP > prev.generatedPitch) ? 1 : (genP < prev.generatedPitch ? -1 : 0);
+        facts.lastPitch = line->lastPitch;
+        const bool newExtreme = pitch < line->lowest || pitch > line->highest;
+        line->advance(pitch);
+        facts.leapRun = line->leapRun;
+        facts.span = newExtreme ? line->highest - line->lowest : 0;
+        return facts;
+    };
+    f.input = advanceLine(context.input, current.inputPitch);
+    f.generated = advanceLine(context.generated, current.generatedPitch);
 
-        if ((prevInt == 7 || prevInt == 0) && (currInt == 7 || currInt == 0) &&
-            motionIn == motionGen && motionIn != 0)
-        {
-            // Determine if this is a parallel 5th or parallel octave
-            ViolationKind violationKind;
-            if ((prevInt == 0 || prevInt == 12) && (currInt == 0 || currInt == 12))
-                violationKind = ViolationKind::ParallelOctave;
-            else if ((prevInt == 7 || prevInt == 19) && (currInt == 7 || currInt == 19))
-                violationKind = ViolationKind::ParallelFifth;
-            else
-                violationKind = ViolationKind::ParallelFifth; // Default fallback
-                
-            out.push_back({
-                violationKind,
-                1.0f, genP, prev.generatedPitch, inP, t,
-                "Parallel motion between perfect intervals (" +
-                    intervalName(prevInt) + " → " + intervalName(currInt) + ").",
-                "→ Avoid parallel 5ths/8ves; use contrary motion.", 0.9f
-            });
-        }
-    }
+    return preset.evaluate(f, out);
+}
 
+std::vector<Violation> RuleChecker::evaluate(std::span<const NotePair> H,
+                                             int inP, int genP, double t) const
+{
+    std::vector<Violation> out;
+
+    // Always push a result (so current interval always visible)
+    if (IntervalTables::isConsonant(genP - inP))
+        out.push_back({ViolationKind::Consonance, 0.0f, genP, -1, inP, t, -1, IntervalTables::intervalClass(genP - inP), 0.0f});
+
+    MelodicState line;
+    for (size_t i = 0; i + 1 < H.size(); ++i)
+        line.advance(H[i].generatedPitch);
+
+    PairContext context;
+    context.generated = &line;
+
+    Violation found[maxPairViolations];
+    const int n = evaluatePair(H.size() >= 2 ? &H[H.size() - 2] : nullptr, { inP, genP, t }, context, found);
+    out.insert(out.end(), found, found + n);
     return out;
 }
 
-float RuleChecker::evaluateScore(const std::vector<NotePair>& H,
-                                 int inP, int genP, double t) const
+float RuleChecker::evaluateScore(std::span<const NotePair> H, int inP, int genP) const
 {
-    auto v = evaluate(H, inP, genP, t);
-    // Start from 1.0, subtract penalty for each violation severity
+    // Same penalties as evaluate(), read straight from the tables without building violations
     float score = 1.0f;
-    for (auto& x : v)
-        score -= 0.3f * x.severity;  // weight violations
+    if (!IntervalTables::isConsonant(genP - inP))
+        score -= 0.3f;
+
+    if (H.size() >= 2)
+    {
+        const NotePair& prev = H[H.size() - 2];
+        if (IntervalTables::motionViolations(prev.inputPitch, prev.generatedPitch, inP, genP)
+            & (IntervalTables::ParallelFifth | IntervalTables::ParallelOctave))
+            score -= 0.3f;
+    }
     return juce::jlimit(0.0f, 1.0f, score);
 }
 
+CandidateMasks RuleChecker::evaluateBatch(std::span<const NotePair> H, int inP,
+                                          std::span<const int> candidates, float* scoresOut) const
+{
+    jassert(candidates.size() <= (size_t)maxBatchCandidates);
+    const int n = (int)juce::jmin(candidates.size(), (size_t)maxBatchCandidates);
+    return batchKernel().fn(makeBatchContext(H.empty() ? nullptr : &H.back(), inP), candidates.data(), n, scoresOut);
+}
+
+CandidateMasks RuleChecker::evaluateBatch(const TimelineView& H, int inP,
+                                          std::span<const int> candidates, float* scoresOut) const
+{
+    jassert(candidates.size() <= (size_t)maxBatchCandidates);
+    const int n = (int)juce::jmin(candidates.size(), (size_t)maxBatchCandidates);
+    const NotePair prev = H.empty() ? NotePair() : H.back();
+    return batchKernel().fn(makeBatchContext(H.empty() ? nullptr : &prev, inP), candidates.data(), n, scoresOut);
+}
+
+CandidateMasks RuleChecker::evaluateBatchScalar(std::span<const NotePair> H, int inP,
+                                                std::span<const int> candidates, float* scoresOut) const
+{
+    jassert(candidates.size() <= (size_t)maxBatchCandidates);
+    const int n = (int)juce::jmin(candidates.size(), (size_t)maxBatchCandidates);
+    return batchScalar(makeBatchContext(H.empty() ? nullptr : &H.back(), inP), candidates.data(), n, scoresOut);
+}
+
+const char* RuleChecker::batchKernelName() { return batchKernel().name; }
+
 juce::String RuleChecker::intervalName(int semitones) const
 {
     return ::intervalName(semitones);
 }
+
+juce::String RuleChecker::kindName(ViolationKind kind)
+{
+    switch (kind)
+    {
+        case ViolationKind::ParallelFifth:          return "Parallel 5th";
+        case ViolationKind::ParallelOctave:         return "Parallel octave";
+        case ViolationKind::DissonanceOnStrongBeat: return "Dissonance";
+        case ViolationKind::HiddenFifthOctave:      return "Hidden fifth/octave";
+        case ViolationKind::VoiceCrossing:          return "Voice crossing";
+        case ViolationKind::LargeLeap:              return "Large leap";
+        case ViolationKind::DirectMotionToPerfect:  return "Direct motion to perfect interval";
+        case ViolationKind::RangeExceeded:          return "Range exceeded";
+        case ViolationKind::Consonance:             return "Consonance";
+        case ViolationKind::FinalSonority:          return "Final sonority";
+        case ViolationKind::Other:                  break;
+    }
+    return "Rule violation";
+}
+
+juce::String RuleChecker::describe(const Violation& v)
+{
+    const juce::String to = ::intervalName(v.intervalTo);
+    const juce::String motion = v.intervalFrom >= 0 ? ::intervalName(v.intervalFrom) + " → " + to : to;
+
+    switch (v.kind)
+    {
+        case ViolationKind::Consonance:
+            return "Consonant interval: " + to + " is acceptable.";
+        case ViolationKind::DissonanceOnStrongBeat:
+            return "Dissonant interval: " + to + " is not allowed in strict counterpoint.";
+        case ViolationKind::ParallelFifth:
+        case ViolationKind::ParallelOctave:
+            return "Parallel motion between perfect intervals: " + motion + ".";
+        case ViolationKind::HiddenFifthOctave:
+            return "Hidden/direct motion to perfect interval: " + motion + ".";
+        case ViolationKind::DirectMotionToPerfect:
+            return "Similar motion into a perfect interval with a leap in the upper voice: " + motion + ".";
+        case ViolationKind::VoiceCrossing:
+            return "Voices cross: the counterpoint is now on the other side of the melody (" + to + ").";
+        case ViolationKind::FinalSonority:
+            return "Final sonority should be perfect (1 or 8).";
+        case ViolationKind::LargeLeap:
+            return "Leaps in one direction add up to " + juce::String(v.intervalTo) + " semitones.";
+        case ViolationKind::RangeExceeded:
+            return "Voice now spans " + juce::String(v.intervalTo) + " semitones.";
+        default:
+            return kindName(v.kind) + ": " + motion + ".";
+    }
+}
+
+juce::String RuleChecker::suggest(const Violation& v)
+{
+    switch (v.kind)
+    {
+        case ViolationKind::DissonanceOnStrongBeat:
+            return "Use consonant intervals: unison, 3rd, 4th, 5th, 6th, or octave.";
+        case ViolationKind::ParallelFifth:
+        case ViolationKind::ParallelOctave:
+            return "Avoid parallel 5ths/8ves; use contrary or oblique motion instead.";
+        case ViolationKind::HiddenFifthOctave:
+            return "Avoid approaching perfect intervals in similar motion; use contrary motion.";
+        case ViolationKind::DirectMotionToPerfect:
+            return "Approach perfect intervals by step in the upper voice, or in contrary motion.";
+        case ViolationKind::VoiceCrossing:
+            return "Keep the counterpoint on its own side of the melody.";
+        case ViolationKind::FinalSonority:
+            return "End on a perfect consonance.";
+        case ViolationKind::LargeLeap:
+            return "Keep leaps within an octave and recover with a step the other way.";
+        case ViolationKind::RangeExceeded:
+            return "Keep each voice within a tenth.";
+        default:
+            return {};
+    }
+}
@@ -1,29 +1,77 @@
 #pragma once
 #include <juce_core/juce_core.h>
+#include <span>
 #include <vector>
 #include "ECCTypes.h"
+#include "NoteHistory.h"
+#include "RulePolicies.h"
+#include "SessionTimeline.h"
 
-// Forward declaration
-struct NotePair;
+// Rule results for a batch of candidates; bit i is candidate i
+struct CandidateMasks
+{
+    juce::uint32 dissonant = 0;
+    juce::uint32 parallelFifth = 0;
+    juce::uint32 parallelOctave = 0;
+    juce::uint32 hiddenPerfect = 0;
+    juce::uint32 legal = 0;            // breaks none of the rules evaluateScore penalises
+};
 
 class RuleChecker {
 public:
-    // Given last two note pairs and the new candidate (inputPitch -> genPitch), return violations.
-    std::vector<Violation> evaluate(const std::vector<ExplanationNotePair>& history,
+    static constexpr int maxBatchCandidates = 32;
+    static constexpr int lookBack = 1;             // sonorities before the current one the rules read
+    static constexpr int maxPairViolations = 9;    // room for any preset's rules on one pair
+
+    // Named rule sets (see RuleSets), e.g. for different courses; a checker starts with the
+    // first, "strict". Only evaluate and evaluatePair follow the preset: the generator's
+    // evaluateScore and evaluateBatch always penalise dissonance and parallels.
+    static std::span<const RulePreset> presets();
+    bool setPreset(const juce::String& name);      // false, and no change, if there is no such preset
+    void setPreset(const RulePreset& custom);
+    const RulePreset& getPreset() const { return preset; }
+
+    // Given the timeline so far and the new candidate (inputPitch -> genPitch), return violations.
+    std::vector<Violation> evaluate(const TimelineView& history,
                                     int inputPitch, int genPitch, double nowSec, bool inPhrase) const;
     
-    // Overload for NotePair history (for CounterpointEngine compatibility)
-    std::vector<Violation> evaluate(const std::vector<NotePair>& history,
+    // The preset's rules for one two-voice sonority, given the one before it (nullptr if
+    // none): the interval, the motion of each voice and its leap are worked out once, then
+    // one call runs the whole compiled set. Writes to out and returns how many; never allocates.
+    int evaluatePair(const NotePair* previous, const NotePair& current, const PairContext& context,
+                     Violation* out) const;
+
+    // Overload for NotePair history (for CounterpointEngine compatibility).
+    // history ends with the candidate pair; the pair before it is the previous note.
+    std::vector<Violation> evaluate(std::span<const NotePair> history,
                                     int inputPitch, int genPitch, double nowSec) const;
     
-    // Evaluate score for NotePair history (for CounterpointEngine compatibility)
-    float evaluateScore(const std::vector<NotePair>& history,
-                        int inputPitch, int candidatePitch, double nowSec) const;
+    // Evaluate score for NotePair history (for CounterpointEngine compatibility); never allocates
+    float evaluateScore(std::span<const NotePair> history, int inputPitch, int candidatePitch) const;
+
+    // Every candidate for one input note at once (up to maxBatchCandidates). Unlike
+    // evaluateScore, history ends with the pair before the candidates. scoresOut gets
+    // what evaluateScore would return for each. Uses AVX2 lanes when the CPU has them.
+    CandidateMasks evaluateBatch(std::span<const NotePair> history, int inputPitch,
+                                 std::span<const int> candidatePitches, float* scoresOut) const;
+    CandidateMasks evaluateBatch(const TimelineView& history, int inputPitch,
+                                 std::span<const int> candidatePitches, float* scoresOut) const;
+    // The portable loop evaluateBatch falls back to
+    CandidateMasks evaluateBatchScalar(std::span<const NotePair> history, int inputPitch,
+                                       std::span<const int> candidatePitches, float* scoresOut) const;
+    static const char* batchKernelName();
     
     // Get interval name from semitones
     juce::String intervalName(int semitones) const;
 
+    // Text for a violation, built on demand for display
+    static juce::String kindName(ViolationKind kind);        // short label, e.g. "Parallel 5th"
+    static juce::String describe(const Violation& v);
+    static juce::String suggest(const Violation& v);         // empty if there is nothing to fix
+
 private:
+    RulePreset preset = presets().front();
+
     bool isPerfect(int semis) const;
     bool isConsonant(int semis) const;
     bool isPerfectInterval(int semitones) const;
@@ -0,0 +1,233 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include "ECCTypes.h"
+#include "IntervalTables.h"
+#include "NoteHistory.h"
+
+// Counterpoint rules as policy types. A rule set is a type list of policies, so a preset
+// compiles to one function with every rule of the set inlined: nothing decides at run
+// time which rules are on, and a rule outside the set costs nothing. RuleChecker keeps
+// a registry of named presets and calls the chosen one once per pair.
+
+// One voice's line so far, as the leap and range rules need it
+struct MelodicState
+{
+    int lastPitch = -1;
+    int lowest = 128, highest = -1;
+    int leapRun = 0;                      // semitones leapt in the current direction
+    int leapDirection = 0;                // -1, 0 or 1
+
+    void advance(int pitch);
+};
+
+// What evaluatePair knows about a sonority beyond the two pairs
+struct PairContext
+{
+    int voiceOrder = 0;                   // 1: the generated voice belongs above the input, -1: below, 0: either
+    bool isFinal = false;                 // closes the phrase, so should be perfect
+    MelodicState* input = nullptr;        // each voice's line before this note, advanced past it by
+    MelodicState* generated = nullptr;    // evaluatePair; nullptr leaves the voice out of the leap and range rules
+};
+
+// A voice's line just after this note; all zero when the line is not being judged
+struct LineFacts
+{
+    int lastPitch = -1;                   // the note before, -1 if none
+    int leapRun = 0;
+    int span = 0;                         // highest minus lowest, only if this note set a new extreme
+};
+
+// Everything the rules read about one two-voice sonority, worked out once per pair
+struct SonorityFacts
+{
+    NotePair current;
+    int diff = 0;                         // generated minus input
+    int interval = 0;                     // |diff|
+    uint8_t flags = 0;                    // IntervalTables::IntervalFlag
+    int prevGen = 0;
+    int prevDiff = 0;
+    int prevInterval = -1;                // -1 without a previous pair
+    int moveIn = 0;
+    int moveGen = 0;
+    uint8_t motion = 0;                   // IntervalTables::MotionViolation
+    int voiceOrder = 0;
+    bool isFinal = false;
+    LineFacts input, generated;
+
+    int upperMove() const { return diff >= 0 ? moveGen : moveIn; }
+
+    Violation violation(ViolationKind kind, int notePrev, int intervalFrom, int intervalTo, float weight) const
+    {
+        return { kind, 1.0f, current.generatedPitch, notePrev, current.inputPitch, current.timestamp,
+                 intervalFrom, intervalTo, weight };
+    }
+};
+
+// Each policy writes the violations it finds, at most maxViolations, and returns how many
+namespace Rules
+{
+    struct Dissonance
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            if ((f.flags & IntervalTables::Consonant) != 0)
+                return 0;
+            *out = f.violation(ViolationKind::DissonanceOnStrongBeat, 0, -1, f.interval, 0.7f);
+            return 1;
+        }
+    };
+
+    struct ParallelPerfect
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            if ((f.motion & (IntervalTables::ParallelFifth | IntervalTables::ParallelOctave)) == 0)
+                return 0;
+            const bool octave = (f.motion & IntervalTables::ParallelOctave) != 0;
+            *out = f.violation(octave ? ViolationKind::ParallelOctave : ViolationKind::ParallelFifth,
+                               f.prevGen, f.prevInterval, f.interval, 0.9f);
+            return 1;
+        }
+    };
+
+    // Similar motion into a perfect interval; worse when the upper voice leaps into it
+    struct HiddenPerfect
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            if ((f.motion & IntervalTables::HiddenPerfect) == 0)
+                return 0;
+            const bool leap = std::abs(f.upperMove()) > 2;
+            *out = f.violation(leap ? ViolationKind::DirectMotionToPerfect : ViolationKind::HiddenFifthOctave,
+                               f.prevGen, f.prevInterval, f.interval, leap ? 0.8f : 0.6f);
+            return 1;
+        }
+    };
+
+    // Only the leaping case of HiddenPerfect, as free counterpoint allows a stepwise approach
+    struct DirectMotion
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            if ((f.motion & IntervalTables::HiddenPerfect) == 0 || std::abs(f.upperMove()) <= 2)
+                return 0;
+            *out = f.violation(ViolationKind::DirectMotionToPerfect, f.prevGen, f.prevInterval, f.interval, 0.8f);
+            return 1;
+        }
+    };
+
+    // On the wrong side of the input when the order is known, otherwise the voices swapping places
+    struct VoiceCrossing
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            const bool crossed = f.voiceOrder != 0 ? f.diff * f.voiceOrder < 0 : f.diff * f.prevDiff < 0;
+            if (!crossed)
+                return 0;
+            *out = f.violation(ViolationKind::VoiceCrossing, f.prevGen, f.prevInterval, f.interval, 0.7f);
+            return 1;
+        }
+    };
+
+    struct FinalSonority
+    {
+        static constexpr int maxViolations = 1;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            if (!f.isFinal || (f.flags & IntervalTables::Perfect) != 0)
+                return 0;
+            *out = f.violation(ViolationKind::FinalSonority, 0, -1, f.interval, 0.5f);
+            return 1;
+        }
+    };
+
+    // Leaps one way may add up to maxRun semitones, in each judged line
+    template <int maxRun = 12>
+    struct LargeLeap
+    {
+        static constexpr int maxViolations = 2;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            const int n = check(f, f.input, out);
+            return n + check(f, f.generated, out + n);
+        }
+
+        static int check(const SonorityFacts& f, const LineFacts& line, Violation* out)
+        {
+            if (line.lastPitch < 0 || line.leapRun <= maxRun)
+                return 0;
+            *out = f.violation(ViolationKind::LargeLeap, line.lastPitch, -1, line.leapRun, 0.5f);
+            return 1;
+        }
+    };
+
+    // A judged line may span maxSpan semitones from its lowest to its highest note
+    template <int maxSpan = 16>
+    struct Range
+    {
+        static constexpr int maxViolations = 2;
+        static int check(const SonorityFacts& f, Violation* out)
+        {
+            const int n = check(f, f.input, out);
+            return n + check(f, f.generated, out + n);
+        }
+
+        static int check(const SonorityFacts& f, const LineFacts& line, Violation* out)
+        {
+            if (line.span <= maxSpan)
+                return 0;
+            *out = f.violation(ViolationKind::RangeExceeded, line.lastPitch, -1, line.span, 0.4f);
+            return 1;
+        }
+    };
+}
+
+// The rules of a set run in list order, so the order of the list is the order of the report
+template <typename... Policies>
+struct RuleSet
+{
+    static constexpr int maxViolations = (0 + ... + Policies::maxViolations);
+
+    static int evaluate(const SonorityFacts& f, Violation* out)
+    {
+        int n = 0;
+        ((n += Policies::check(f, out + n)), ...);
+        return n;
+    }
+};
+
+namespace RuleSets
+{
+    // Species counterpoint as taught from Fux: every rule
+    using Strict = RuleSet<Rules::Dissonance, Rules::ParallelPerfect, Rules::HiddenPerfect, Rules::VoiceCrossing,
+                           Rules::FinalSonority, Rules::LargeLeap<>, Rules::Range<>>;
+
+    // Free counterpoint: passing dissonance, stepwise hidden fifths and brief crossings are
+    // fine, and a voice may range over a twelfth
+    using Free = RuleSet<Rules::ParallelPerfect, Rules::DirectMotion, Rules::FinalSonority,
+                         Rules::LargeLeap<>, Rules::Range<19>>;
+
+    // Only parallel fifths and octaves, e.g. for harmony exercises
+    using Parallels = RuleSet<Rules::ParallelPerfect>;
+}
+
+// One compiled rule set under a name, for RuleChecker's registry
+struct RulePreset
+{
+    const char* name;
+    const char* description;
+    int (*evaluate)(const SonorityFacts&, Violation*);
+    int maxViolations;
+};
+
+template <typename Set>
+constexpr RulePreset makeRulePreset(const char* name, const char* description)
+{
+    return { name, description, &Set::evaluate, Set::maxViolations };
+}
@@ -0,0 +1,297 @@
+#include "ScoreAnalyzer.h"
+#include "ChunkedJobs.h"
+#include <algorithm>
+#include <array>
+#include <map>
+
+namespace
+{
+    struct VoiceNote { double start; double end; int pitch; };
+
+    double millisSince(juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    }
+
+    // Notes of one voice in onset order, a chord reduced to its highest note
+    void addNotes(const juce::MidiMessageSequence& track, int channel, std::vector<VoiceNote>& notes)
+    {
+        std::array<int, 128> open;               // index into notes of the sounding note per pitch
+        open.fill(-1);
+        double lastTime = 0.0;
+
+        for (const auto* event : track)
+        {
+            const auto& msg = event->message;
+            if (channel > 0 && msg.getChannel() != channel)
+                continue;
+
+            const double t = msg.getTimeStamp();
+            lastTime = juce::jmax(lastTime, t);
+
+            if (msg.isNoteOn())
+            {
+                const int pitch = msg.getNoteNumber();
+                if (!notes.empty() && notes.back().start == t)
+                {
+                    if (pitch <= notes.back().pitch)
+                        continue;
+                    open[(size_t)notes.back().pitch] = -1;
+                    notes.back().pitch = pitch;
+                }
+                else
+                {
+                    notes.push_back({ t, -1.0, pitch });
+                }
+                open[(size_t)pitch] = (int)notes.size() - 1;
+            }
+            else if (msg.isNoteOff())
+            {
+                int& index = open[(size_t)msg.getNoteNumber()];
+                if (index >= 0 && notes[(size_t)index].end < 0.0)
+                    notes[(size_t)index].end = t;
+                index = -1;
+            }
+        }
+
+        // A note that is never released lasts until the end of its track
+        for (auto& note : notes)
+            if (note.end < 0.0)
+                note.end = lastTime;
+    }
+}
+
+int ScoreReport::count(ViolationKind kind) const
+{
+    return (int)std::count_if(violations.begin(), violations.end(),
+                              [kind](const ScoreViolation& v) { return v.violation.kind == kind; });
+}
+
+juce::String ScoreReport::toText() const
+{
+    juce::MemoryOutputStream out;
+    out << numVoices << " voices, " << numNotes << " notes, " << numSonorities << " sonorities: "
+        << (int)violations.size() << " violation(s)\n";
+
+    for (const auto& v : violations)
+        out << juce::String(v.violation.time, 2) << "s  voices " << v.lowerVoice + 1 << "-" << v.upperVoice + 1
+            << "  " << RuleChecker::kindName(v.violation.kind) << ": " << RuleChecker::describe(v.violation) << "\n";
+
+    std::map<int, int> perKind;
+    for (const auto& v : violations)
+        ++perKind[(int)v.violation.kind];
+    for (const auto& [kind, n] : perKind)
+        out << RuleChecker::kindName((ViolationKind)kind) << ": " << n << "\n";
+
+    return out.toString();
+}
+
+ScoreAnalyzer::ScoreAnalyzer()
+    : pool(ChunkedJobs::makePool("ScoreAnalyzer"))
+{
+}
+
+ScoreAnalyzer::~ScoreAnalyzer() = default;
+
+AlignedScore ScoreAnalyzer::align(const juce::MidiFile& file)
+{
+    juce::MidiFile timed(file);
+    timed.convertTimestampTicksToSeconds();
+
+    // A single track with notes is split by channel; otherwise each track is a voice
+    std::vector<const juce::MidiMessageSequence*> noteTracks;
+    for (int t = 0; t < timed.getNumTracks(); ++t)
+    {
+        const auto* track = timed.getTrack(t);
+        if (std::any_of(track->begin(), track->end(), [](const auto* e) { return e->message.isNoteOn(); }))
+            noteTracks.push_back(track);
+    }
+
+    std::vector<std::vector<VoiceNote>> voices;
+    if (noteTracks.size() == 1)
+    {
+        for (int channel = 1; channel <= 16; ++channel)
+        {
+            voices.emplace_back();
+            addNotes(*noteTracks[0], channel, voices.back());
+        }
+    }
+    else
+    {
+        for (const auto* track : noteTracks)
+        {
+            voices.emplace_back();
+            addNotes(*track, 0, voices.back());
+        }
+    }
+
+    auto meanPitch = [](const std::vector<VoiceNote>& notes) {
+        double sum = 0.0;
+        for (const auto& n : notes)
+            sum += n.pitch;
+        return sum / (double)notes.size();
+    };
+
+    voices.erase(std::remove_if(voices.begin(), voices.end(), [](const auto& v) { return v.empty(); }), voices.end());
+    if (voices.size() > (size_t)AlignedScore::maxVoices)
+        voices.resize((size_t)AlignedScore::maxVoices);
+    std::stable_sort(voices.begin(), voices.end(),
+                     [&](const auto& a, const auto& b) { return meanPitch(a) < meanPitch(b); });
+
+    AlignedScore score;
+    score.numVoices = (int)voices.size();
+    for (const auto& v : voices)
+    {
+        score.numNotes += (int)v.size();
+        for (const auto& n : v)
+            score.times.push_back(n.start);
+    }
+
+    std::sort(score.times.begin(), score.times.end());
+    score.times.erase(std::unique(score.times.begin(), score.times.end()), score.times.end());
+
+    const int numSonorities = score.size();
+    score.pitches.assign((size_t)numSonorities * (size_t)score.numVoices, (juce::int8)-1);
+    score.attacks.assign((size_t)numSonorities, 0);
+
+    // Each voice is monophonic by now, so one pass per voice finds what sounds at each onset
+    for (int v = 0; v < score.numVoices; ++v)
+    {
+        const auto& notes = voices[(size_t)v];
+        size_t k = 0;
+        for (int i = 0; i < numSonorities; ++i)
+        {
+            const double t = score.times[(size_t)i];
+            while (k + 1 < notes.size() && notes[k + 1].start <= t)
+                ++k;
+
+            const auto& note = notes[k];
+            const bool attack = note.start == t;
+            if (attack || (note.start < t && t < note.end))
+                score.pitches[(size_t)(i * score.numVoices + v)] = (juce::int8)note.pitch;
+            if (attack)
+                score.attacks[(size_t)i] |= (juce::uint16)(1u << v);
+        }
+    }
+
+    return score;
+}
+
+ScoreReport ScoreAnalyzer::analyse(const juce::MidiFile& file) const
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    const AlignedScore score = align(file);
+    const double alignMillis = millisSince(start);
+
+    ScoreReport report = analyse(score);
+    report.alignMillis = alignMillis;
+    return report;
+}
+
+ScoreReport ScoreAnalyzer::analyse(const AlignedScore& score) const
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    ScoreReport report;
+    report.numVoices = score.numVoices;
+    report.numNotes = score.numNotes;
+    report.numSonorities = score.size();
+
+    const int numJobs = ChunkedJobs::jobsFor(pool.get(), (size_t)score.size(), minSonoritiesPerJob);
+    std::vector<std::vector<ScoreViolation>> found((size_t)numJobs);
+    const int chunk = (score.size() + numJobs - 1) / numJobs;
+
+    // Each voice's line at the start of every chunk, from one pass over the attacks
+    std::vector<Lines> starts((size_t)numJobs);
+    for (int job = 1; job < numJobs; ++job)
+    {
+        Lines& lines = starts[(size_t)job];
+        lines = starts[(size_t)job - 1];
+        for (int i = juce::jmin(score.size(), (job - 1) * chunk); i < juce::jmin(score.size(), job * chunk); ++i)
+            for (int v = 0; v < score.numVoices; ++v)
+                if (score.isAttack(i, v))
+                    lines[(size_t)v].advance(score.pitch(i, v));
+    }
+
+    ChunkedJobs::runChunked(pool.get(), numJobs, [&](int job)
+    {
+        const int begin = juce::jmin(score.size(), job * chunk);
+        checkRange(score, begin, juce::jmin(score.size(), begin + chunk), starts[(size_t)job], found[(size_t)job]);
+    });
+
+    size_t total = 0;
+    for (const auto& part : found)
+        total += part.size();
+    report.violations.reserve(total);
+    for (const auto& part : found)
+        report.violations.insert(report.violations.end(), part.begin(), part.end());
+
+    report.rulesMillis = millisSince(start);
+    return report;
+}
+
+void ScoreAnalyzer::checkRange(const AlignedScore& score, int begin, int end, Lines lines,
+                               std::vector<ScoreViolation>& out) const
+{
+    // The harmonic rules compare each sonority with the one before it; for the first
+    // sonority of a chunk that one belongs to the previous chunk and is only read here
+    static_assert(RuleChecker::lookBack == 1);
+
+    const int numVoices = score.numVoices;
+    const int last = score.size() - 1;
+    Violation found[RuleChecker::maxPairViolations];
+
+    for (int i = begin; i < end; ++i)
+    {
+        const juce::int8* now = score.pitches.data() + (size_t)i * (size_t)numVoices;
+        const juce::int8* before = i > 0 ? now - numVoices : nullptr;
+        const juce::uint16 attacks = score.attacks[(size_t)i];
+        const double t = score.times[(size_t)i];
+
+        // A voice's leaps and range are judged once, in its pair with the lowest other sounding voice
+        std::array<int, AlignedScore::maxVoices> partner;
+        for (int v = 0; v < numVoices; ++v)
+        {
+            partner[(size_t)v] = -1;
+            for (int w = 0; w < numVoices && partner[(size_t)v] < 0; ++w)
+                if (w != v && now[w] >= 0)
+                    partner[(size_t)v] = w;
+        }
+
+        for (int lower = 0; lower < numVoices; ++lower)
+        {
+            if (now[lower] < 0)
+                continue;
+
+            for (int upper = lower + 1; upper < numVoices; ++upper)
+            {
+                // Judged where either voice moves; a held pair was judged when it began
+                if (now[upper] < 0 || (attacks & ((1u << lower) | (1u << upper))) == 0)
+                    continue;
+
+                const NotePair current { now[lower], now[upper], t };
+                NotePair previous;
+                const bool hasPrevious = before != nullptr && before[lower] >= 0 && before[upper] >= 0;
+                if (hasPrevious)
+                    previous = { before[lower], before[upper], score.times[(size_t)i - 1] };
+
+                PairContext context;
+                context.voiceOrder = 1;
+                context.isFinal = i == last;
+                if (((attacks >> lower) & 1) != 0 && partner[(size_t)lower] == upper)
+                    context.input = &lines[(size_t)lower];
+                if (((attacks >> upper) & 1) != 0 && partner[(size_t)upper] == lower)
+                    context.generated = &lines[(size_t)upper];
+
+                const int n = rules.evaluatePair(hasPrevious ? &previous : nullptr, current, context, found);
+                for (int k = 0; k < n; ++k)
+                    out.push_back({ i, lower, upper, found[k] });
+            }
+        }
+
+        // A note with no other voice sounding still moves its line on
+        for (int v = 0; v < numVoices; ++v)
+            if (((attacks >> v) & 1) != 0 && partner[(size_t)v] < 0)
+                lines[(size_t)v].advance(now[v]);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include "RuleChecker.h"
+
+// The voices of a score lined up on every onset. Sonority i is what each voice sounds
+// from times[i] until the next onset; pitch -1 is a rest. Voices are ordered by mean
+// pitch, lowest first.
+struct AlignedScore
+{
+    static constexpr int maxVoices = 16;
+
+    int numVoices = 0;
+    int numNotes = 0;
+    std::vector<double> times;               // seconds, one per sonority
+    std::vector<juce::int8> pitches;         // numVoices per sonority
+    std::vector<juce::uint16> attacks;       // bit v: voice v starts a note here
+
+    int size() const { return (int)times.size(); }
+    int pitch(int sonority, int voice) const { return pitches[(size_t)(sonority * numVoices + voice)]; }
+    bool isAttack(int sonority, int voice) const { return (attacks[(size_t)sonority] >> voice) & 1; }
+};
+
+// A rule broken by one pair of voices; the lower voice is the violation's input voice
+struct ScoreViolation
+{
+    int sonority;
+    int lowerVoice;
+    int upperVoice;
+    Violation violation;
+};
+
+struct ScoreReport
+{
+    int numVoices = 0;
+    int numNotes = 0;
+    int numSonorities = 0;
+    std::vector<ScoreViolation> violations;  // by sonority, then voice pair
+    double alignMillis = 0.0;
+    double rulesMillis = 0.0;
+
+    int count(ViolationKind kind) const;
+    // One line per violation plus a per-kind summary, for teachers' feedback
+    juce::String toText() const;
+};
+
+// Offline rule check of a whole imported score, e.g. a student's exercise. Every
+// RuleChecker rule runs over every pair of voices at each sonority where either of them
+// starts a note; a voice's leaps and range are judged once per note, not once per pair.
+// The sonorities are split into chunks across a thread pool; each chunk also reads the
+// RuleChecker::lookBack sonorities before it and starts from each voice's line as one
+// cheap pass over the attacks left it, so the result is the same as one pass from start
+// to end.
+class ScoreAnalyzer {
+public:
+    ScoreAnalyzer();
+    ~ScoreAnalyzer();
+
+    ScoreReport analyse(const juce::MidiFile& file) const;
+    ScoreReport analyse(const AlignedScore& score) const;
+
+    // Which RuleChecker preset to report against, e.g. "free"; false if there is none by that name
+    bool setRulePreset(const juce::String& name) { return rules.setPreset(name); }
+
+    // One voice per track (or per channel of a single-track file) that has notes, up to
+    // AlignedScore::maxVoices; a chord within one voice counts as its highest note.
+    static AlignedScore align(const juce::MidiFile& file);
+
+    static constexpr int minSonoritiesPerJob = 512;   // fewer would spend longer waking a thread than checking them
+
+private:
+    using Lines = std::array<MelodicState, AlignedScore::maxVoices>;   // each voice's line so far
+
+    // lines is each voice's line before begin
+    void checkRange(const AlignedScore& score, int begin, int end, Lines lines, std::vector<ScoreViolation>& out) const;
+
+    RuleChecker rules;
+    std::unique_ptr<juce::ThreadPool> pool;      // only if there are cores to spare
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+#include "ModelBridge.h"
+#include "NoteHistory.h"
+
+// Read-only window onto a SessionTimeline, oldest sonority first: the input and generated
+// lines as note columns. Cheap to copy; valid until the timeline next changes.
+struct TimelineView
+{
+    std::span<const ContextNote> input;
+    std::span<const ContextNote> generated;
+
+    size_t size() const { return generated.size(); }
+    bool empty() const { return generated.empty(); }
+
+    NotePair operator[] (size_t i) const { return { input[i].pitch, generated[i].pitch, generated[i].startSec }; }
+    NotePair back() const { return (*this)[size() - 1]; }
+
+    // The most recent n sonorities (all of them if there are fewer)
+    TimelineView last(size_t n) const
+    {
+        const size_t k = n < size() ? n : size();
+        return { input.last(k), generated.last(k) };
+    }
+
+    // For the search, whose scratch path it extends with candidates
+    void appendTo(std::vector<NotePair>& path) const
+    {
+        for (size_t i = 0; i < size(); ++i)
+            path.push_back((*this)[i]);
+    }
+};
+
+// The phrase so far, stored by column: one note column (pitch, start, end) per voice.
+// The model reads a voice's line as it is and the rules read the last sonorities, so
+// nothing is converted per note. Fixed capacity, oldest dropped first; every slot is
+// stored twice (at i and i + capacity) so each column's live window is one contiguous span.
+class SessionTimeline
+{
+public:
+    static constexpr int capacity = 64;
+
+    enum Voice { inputVoice, generatedVoice, numVoices };
+
+    void push(int inputPitch, int generatedPitch, double timeSec)
+    {
+        write(inputVoice, { inputPitch, timeSec, timeSec });
+        write(generatedVoice, { generatedPitch, timeSec, timeSec });
+        head = (head + 1) % capacity;
+        if (count < capacity)
+            ++count;
+    }
+
+    void push(const NotePair& pair) { push(pair.inputPitch, pair.generatedPitch, pair.timestamp); }
+
+    void clear() { head = 0; count = 0; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    NotePair back() const { return view().back(); }
+
+    // One voice's notes, oldest first; this is the context the model scores against
+    std::span<const ContextNote> line(Voice voice) const
+    {
+        return { lines[(size_t)voice].data() + (head + capacity - count), (size_t)count };
+    }
+
+    TimelineView view() const { return { line(inputVoice), line(generatedVoice) }; }
+
+private:
+    void write(Voice voice, const ContextNote& note)
+    {
+        auto& column = lines[(size_t)voice];
+        column[(size_t)head] = note;
+        column[(size_t)(head + capacity)] = note;
+    }
+
+    std::array<std::array<ContextNote, 2 * capacity>, numVoices> lines {};
+    int head = 0;    // next slot to write
+    int count = 0;
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <juce_core/juce_core.h>
+
+// Intrinsics for the kernels that pick an instruction set at run time. A function marked
+// POLYMUSE_TARGET_AVX2 may use AVX2 without the whole build requiring it, so call it
+// only after juce::SystemStats::hasAVX2(). NEON is part of the ARM baseline instead.
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_GCC || JUCE_CLANG
+  #define POLYMUSE_TARGET_AVX2 __attribute__((target("avx2")))
+ #else
+  #define POLYMUSE_TARGET_AVX2
+ #endif
+#elif JUCE_ARM && defined(__ARM_NEON)
+ #include <arm_neon.h>
+ #define POLYMUSE_HAS_NEON 1
+#endif
@@ -0,0 +1,203 @@
+#include "Speculator.h"
+#include <cstring>
+
+namespace
+{
+    constexpr juce::uint16 majorScale = (1 << 0) | (1 << 2) | (1 << 4) | (1 << 5) | (1 << 7) | (1 << 9) | (1 << 11);
+    constexpr juce::uint16 minorScale = (1 << 0) | (1 << 2) | (1 << 3) | (1 << 5) | (1 << 7) | (1 << 8) | (1 << 10);
+
+    // Most likely moves first: steps, then repeated note, then thirds
+    constexpr int likelyMoves[] = { 1, -1, 2, -2, 0, 3, -3, 4, -4 };
+}
+
+Speculator::Speculator(ModelBridge* m)
+    : juce::Thread("Counterpoint speculation"),
+      model(m != nullptr && m->isThreadSafe() ? m : nullptr),
+      modelWindow(model != nullptr ? (size_t)juce::jlimit(1, SessionTimeline::capacity, model->contextWindow()) : 0)
+{
+    pending.line.reserve(modelWindow);
+
+    startThread(juce::Thread::Priority::low);
+}
+
+Speculator::~Speculator()
+{
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread(1000);
+}
+
+void Speculator::submit(const TimelineView& history, int lastInput, bool above, int keyRoot, bool isMajor,
+                        bool withModel, const SearchConfig& config, juce::uint64 version)
+{
+    {
+        const juce::ScopedLock sl(snapshotLock);
+        pending.history.clear();
+        history.last(BeamSearch::historyNeeded).appendTo(pending.history);
+        const auto line = history.generated.last(juce::jmin(modelWindow, history.generated.size()));
+        pending.line.assign(line.begin(), line.end());
+        pending.lastInput = lastInput;
+        pending.above = above;
+        pending.keyRoot = keyRoot;
+        pending.isMajor = isMajor;
+        pending.withModel = withModel;
+        pending.config = config;
+        pending.version = version;
+        hasPending = true;
+    }
+
+    latestVersion.store(version);
+    wakeUp.signal();
+}
+
+Speculator::Answer Speculator::lookup(juce::uint64 version, int inputPitch, bool above)
+{
+    Answer answer;
+    if (inputPitch >= 0 && inputPitch < (int)table.size())
+    {
+        auto& slot = table[(size_t)inputPitch];
+        const juce::uint64 key = slot.key.load(std::memory_order_acquire);
+        const juce::uint32 scoreBits = slot.score.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (key != 0 && (key >> 16) == version && ((key >> 8) & 1) == (above ? 1u : 0u)
+            && slot.key.load(std::memory_order_relaxed) == key)
+        {
+            ++hits;
+            answer.pitch = (int)(key & 0xff);
+            answer.modelScored = ((key >> 9) & 1) != 0;
+            answer.legal = ((key >> 10) & 1) != 0;
+            std::memcpy(&answer.score, &scoreBits, sizeof(float));
+            return answer;
+        }
+    }
+
+    ++misses;
+    return answer;
+}
+
+SpeculationStats Speculator::getStats() const
+{
+    SpeculationStats s;
+    s.hits = hits.load();
+    s.misses = misses.load();
+    s.computed = computed.load();
+    return s;
+}
+
+void Speculator::resetStats()
+{
+    hits = 0;
+    misses = 0;
+    computed = 0;
+}
+
+bool Speculator::scoreCandidates(const Snapshot& snap, int inputPitch)
+{
+    if (model == nullptr || !snap.withModel)
+        return false;
+
+    int candidates[BeamSearch::maxCandidates];
+    const int n = search.candidatePitches(inputPitch, snap.above, candidates);
+    if (n == 0)
+        return false;
+
+    float probs[BeamSearch::maxCandidates];
+    model->scoreProbabilities(snap.line, { candidates, (size_t)n }, snap.keyRoot, snap.isMajor, { probs, (size_t)n });
+
+    modelBias.fill(0.0f);
+    for (int i = 0; i < n; ++i)
+        modelBias[(size_t)candidates[i]] = SearchLimits::modelWeight * probs[i];
+    return true;
+}
+
+int Speculator::likelyNextPitches(int lastInput, int keyRoot, bool isMajor, int* out) const
+{
+    const juce::uint16 scale = isMajor ? majorScale : minorScale;
+    int n = 0;
+
+    for (int move : likelyMoves)
+    {
+        const int pitch = lastInput + move;
+        if (pitch < 0 || pitch > 127)
+            continue;
+
+        const int degree = ((pitch - keyRoot) % 12 + 12) % 12;
+        if ((scale >> degree) & 1)
+            out[n++] = pitch;
+
+        if (n == maxSpeculated)
+            break;
+    }
+    return n;
+}
+
+void Speculator::publish(juce::uint64 version, int inputPitch, bool above, bool modelScored, const SearchResult& result)
+{
+    const juce::uint64 key = (version << 16) | ((result.legal ? 1u : 0u) << 10) | ((modelScored ? 1u : 0u) << 9)
+                           | ((above ? 1u : 0u) << 8) | (juce::uint64)(result.pitch & 0xff);
+    juce::uint32 scoreBits;
+    std::memcpy(&scoreBits, &result.score, sizeof(float));
+
+    auto& slot = table[(size_t)inputPitch];
+    slot.key.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.score.store(scoreBits, std::memory_order_relaxed);
+    slot.key.store(key, std::memory_order_release);
+}
+
+void Speculator::run()
+{
+    Snapshot snap;
+    std::vector<NotePair> path;
+
+    while (!threadShouldExit())
+    {
+        wakeUp.wait(-1);
+
+        {
+            const juce::ScopedLock sl(snapshotLock);
+            if (!hasPending)
+                continue;
+
+            snap.history.assign(pending.history.begin(), pending.history.end());
+            snap.line.assign(pending.line.begin(), pending.line.end());
+            snap.lastInput = pending.lastInput;
+            snap.above = pending.above;
+            snap.keyRoot = pending.keyRoot;
+            snap.isMajor = pending.isMajor;
+            snap.withModel = pending.withModel;
+            snap.config = pending.config;
+            snap.version = pending.version;
+            hasPending = false;
+        }
+
+        if (snap.lastInput < 0)
+            continue;
+
+        search.setConfig(snap.config);
+        const double nowSec = snap.history.empty() ? 0.0 : snap.history.back().timestamp;
+
+        int pitches[maxSpeculated];
+        const int n = likelyNextPitches(snap.lastInput, snap.keyRoot, snap.isMajor, pitches);
+
+        for (int i = 0; i < n; ++i)
+        {
+            // A newer note makes this snapshot useless; start over with the new one
+            if (threadShouldExit() || latestVersion.load() != snap.version)
+                break;
+
+            // Same stages as the live path with unlimited time: model bias, then full lookahead
+            SearchLimits limits;
+            limits.depth = snap.config.lookaheadDepth;
+            const bool modelScored = scoreCandidates(snap, pitches[i]);
+            if (modelScored)
+                limits.pitchBias = modelBias.data();
+
+            path.assign(snap.history.begin(), snap.history.end());
+            SearchResult result = search.search(path, pitches[i], snap.above, nowSec, limits);
+            publish(snap.version, pitches[i], snap.above, modelScored, result);
+            ++computed;
+        }
+    }
+}
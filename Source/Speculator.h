@@ -0,0 +1,95 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <span>
+#include <vector>
+#include "BeamSearch.h"
+#include "ModelBridge.h"
+#include "SessionTimeline.h"
+
+struct SpeculationStats
+{
+    juce::uint64 hits = 0;
+    juce::uint64 misses = 0;
+    juce::uint64 computed = 0;   // answers precomputed by the background thread
+
+    double hitRate() const { return (hits + misses) > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+};
+
+// Background thread that precomputes counterpoint for the most likely next input
+// pitches (diatonic steps around the last input) while the player is between notes.
+// Answers are stamped with the history version they were computed for, so any
+// change to the history invalidates the whole table at once.
+// When the engine blends the model in and the model is thread-safe, candidates get the
+// same model bias as on the live path; otherwise answers are rule-only.
+class Speculator : private juce::Thread {
+public:
+    explicit Speculator(ModelBridge* model = nullptr);
+    ~Speculator() override;
+
+    // Hand over the state after a committed note; restarts speculation for it. Only the
+    // part of the history the search and the model read is copied.
+    void submit(const TimelineView& history, int lastInput, bool above, int keyRoot, bool isMajor,
+                bool withModel, const SearchConfig& config, juce::uint64 version);
+
+    // What the search found for one input pitch
+    struct Answer
+    {
+        int pitch = -1;                  // -1: nothing precomputed for this history version
+        float score = 0.0f;
+        bool legal = true;
+        bool modelScored = false;        // the model biased it
+    };
+
+    Answer lookup(juce::uint64 version, int inputPitch, bool above);
+
+    SpeculationStats getStats() const;
+    void resetStats();
+
+    static constexpr int maxSpeculated = 6;
+
+private:
+    void run() override;
+    int likelyNextPitches(int lastInput, int keyRoot, bool isMajor, int* out) const;
+    void publish(juce::uint64 version, int inputPitch, bool above, bool modelScored, const SearchResult& result);
+
+    struct Snapshot
+    {
+        std::vector<NotePair> history;   // the last BeamSearch::historyNeeded pairs
+        std::vector<ContextNote> line;   // the generated line, as much as the model reads
+        int lastInput = -1;
+        bool above = true;
+        int keyRoot = 0;
+        bool isMajor = true;
+        bool withModel = false;          // the engine blends the model in, so speculation should too
+        SearchConfig config;
+        juce::uint64 version = 0;
+    };
+
+    // Fills modelBias for inputPitch's candidates; false if there is no model to ask
+    bool scoreCandidates(const Snapshot& snap, int inputPitch);
+
+    juce::CriticalSection snapshotLock;
+    Snapshot pending;
+    bool hasPending = false;
+    std::atomic<juce::uint64> latestVersion { 0 };
+    juce::WaitableEvent wakeUp;
+
+    BeamSearch search;
+    ModelBridge* const model;            // nullptr unless it may be called from this thread
+    const size_t modelWindow;
+    std::array<float, 128> modelBias {};
+
+    // Per input pitch. key is (version << 16) | (legal << 10) | (modelScored << 9) | (above << 8)
+    // | generated pitch, 0 = empty; score holds the result's float bits. publish() clears key
+    // while it writes score, and lookup() only trusts a score read between two equal keys.
+    struct Slot
+    {
+        std::atomic<juce::uint64> key { 0 };
+        std::atomic<juce::uint32> score { 0 };
+    };
+    std::array<Slot, 128> table;
+
+    std::atomic<juce::uint64> hits { 0 }, misses { 0 }, computed { 0 };
+};
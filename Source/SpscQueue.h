@@ -0,0 +1,73 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <vector>
+
+// Occupancy counters for one queue
+struct QueueStats
+{
+    int depth = 0;               // items waiting right now
+    int highWater = 0;           // deepest the queue has been
+    int capacity = 0;
+    juce::uint64 pushed = 0;
+    juce::uint64 dropped = 0;    // pushes rejected because the queue was full
+};
+
+// Single-producer / single-consumer ring buffer on top of juce::AbstractFifo.
+// Storage is allocated once up front; push and pop are wait-free.
+template <typename Item>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity)
+        : fifo(capacity + 1), items((size_t)capacity + 1) {}
+
+    // Producer thread only. Returns false if the queue is full; never blocks.
+    bool push(const Item& item)
+    {
+        {
+            const auto scope = fifo.write(1);
+            if (scope.blockSize1 + scope.blockSize2 == 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            items[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = item;
+        }
+
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        const int depth = fifo.getNumReady();
+        if (depth > highWater.load(std::memory_order_relaxed))
+            highWater.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer thread only. Returns false if there is nothing to read.
+    bool pop(Item& out)
+    {
+        const auto scope = fifo.read(1);
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return false;
+
+        out = std::move(items[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)]);
+        return true;
+    }
+
+    // Safe from any thread; values are a snapshot
+    QueueStats getStats() const
+    {
+        QueueStats s;
+        s.depth = fifo.getNumReady();
+        s.highWater = highWater.load(std::memory_order_relaxed);
+        s.capacity = fifo.getTotalSize() - 1;
+        s.pushed = pushed.load(std::memory_order_relaxed);
+        s.dropped = dropped.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<Item> items;
+    std::atomic<int> highWater { 0 };
+    std::atomic<juce::uint64> pushed { 0 }, dropped { 0 };
+};
@@ -0,0 +1,31 @@
+#include "StreamingRuleChecker.h"
+#include "IntervalTables.h"
+
+void StreamingRuleChecker::reset()
+{
+    voices = {};
+    previous = {};
+    numPairs = 0;
+    events.count = 0;
+}
+
+const StreamingRuleChecker::Events& StreamingRuleChecker::push(const NotePair& pair)
+{
+    events.count = 0;
+    const int interval = IntervalTables::intervalClass(pair.generatedPitch - pair.inputPitch);
+
+    // Always report the interval, so the tutor can show it even when nothing is wrong
+    if (IntervalTables::isConsonant(interval))
+        events.items[(size_t)events.count++] = { ViolationKind::Consonance, 0.0f, pair.generatedPitch, -1, pair.inputPitch,
+                                                 pair.timestamp, -1, interval, 0.0f };
+
+    PairContext context;
+    context.input = &voices[0];
+    context.generated = &voices[1];
+    events.count += rules.evaluatePair(numPairs > 0 ? &previous : nullptr, pair, context,
+                                       events.items.data() + events.count);
+
+    previous = pair;
+    ++numPairs;
+    return events;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include "ECCTypes.h"
+#include "NoteHistory.h"
+#include "RuleChecker.h"
+
+// Rule checking for a line that arrives one pair at a time, as in tutor mode. Rather
+// than re-reading the history on every note, it keeps just what the rules look back
+// at: the previous sonority (for parallels and the approach to a perfect interval),
+// and per voice its MelodicState. The rules themselves are RuleChecker::evaluatePair.
+// push() costs the same whatever the phrase length and never allocates.
+class StreamingRuleChecker {
+public:
+    static constexpr int maxPerEvent = RuleChecker::maxPairViolations + 1;   // plus the Consonance entry
+
+    // This event's violations; valid until the next push()
+    struct Events
+    {
+        std::array<Violation, maxPerEvent> items;
+        int count = 0;
+
+        const Violation* begin() const { return items.data(); }
+        const Violation* end() const { return items.data() + count; }
+        bool empty() const { return count == 0; }
+    };
+
+    const Events& push(const NotePair& pair);
+    void reset();
+
+    int size() const { return numPairs; }
+    const MelodicState& voice(int v) const { return voices[(size_t)v]; }   // 0 = input, 1 = generated
+
+private:
+    RuleChecker rules;
+    std::array<MelodicState, 2> voices;
+    NotePair previous;
+    int numPairs = 0;
+    Events events;
+};
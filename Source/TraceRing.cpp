@@ -0,0 +1,172 @@
+#include "TraceRing.h"
+#include "IntervalTables.h"
+
+void TraceRing::write(TraceRecord record)
+{
+    const juce::uint32 w = writePos.load(std::memory_order_relaxed);
+    if (w - readPos.load(std::memory_order_acquire) >= capacity)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record.thread = thread;
+    records[w & (capacity - 1)] = record;
+    writePos.store(w + 1, std::memory_order_release);
+}
+
+int TraceRing::read(TraceRecord* out, int maxRecords)
+{
+    const juce::uint32 r = readPos.load(std::memory_order_relaxed);
+    const juce::uint32 available = writePos.load(std::memory_order_acquire) - r;
+    const int n = (int)juce::jmin((juce::uint32)maxRecords, available);
+
+    for (int i = 0; i < n; ++i)
+        out[i] = records[(r + (juce::uint32)i) & (capacity - 1)];
+
+    readPos.store(r + (juce::uint32)n, std::memory_order_release);
+    return n;
+}
+
+namespace
+{
+    // Rings live for the whole process so records survive their thread
+    struct Registry
+    {
+        juce::CriticalSection lock;
+        juce::OwnedArray<TraceRing> rings;
+    };
+
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+   #if POLYMUSE_TRACE
+    TraceRing& localRing()
+    {
+        thread_local TraceRing* ring = nullptr;
+        if (ring == nullptr)
+        {
+            auto& reg = registry();
+            const juce::ScopedLock sl(reg.lock);
+            ring = reg.rings.add(new TraceRing((juce::uint16)reg.rings.size()));
+        }
+        return *ring;
+    }
+   #endif
+
+    const char* eventName(TraceEvent e)
+    {
+        switch (e)
+        {
+            case TraceEvent::Generated:        return "generated";
+            case TraceEvent::NoLegalCandidate: return "no legal candidate";
+            case TraceEvent::Committed:        return "committed";
+            case TraceEvent::NoteOff:          return "note off";
+            case TraceEvent::NoMapping:        return "no mapping";
+            case TraceEvent::Voicing:          return "voicing";
+            case TraceEvent::Alternative:      return "alternative";
+        }
+        return "?";
+    }
+}
+
+namespace Trace
+{
+    void record(TraceEvent event, int inputPitch, int generatedPitch,
+                int attempts, float value, juce::uint8 flags, int depth)
+    {
+       #if POLYMUSE_TRACE
+        TraceRecord r;
+        r.ticks = juce::Time::getHighResolutionTicks();
+        r.attempts = attempts;
+        r.value = value;
+        r.event = event;
+        r.inputPitch = (juce::int8)juce::jlimit(-1, 127, inputPitch);
+        r.generatedPitch = (juce::int8)juce::jlimit(-1, 127, generatedPitch);
+        if (inputPitch >= 0 && generatedPitch >= 0)
+            r.interval = (juce::int8)IntervalTables::intervalClass(generatedPitch - inputPitch);
+        r.flags = flags;
+        r.depth = (juce::uint8)juce::jlimit(0, 255, depth);
+        localRing().write(r);
+       #else
+        juce::ignoreUnused(event, inputPitch, generatedPitch, attempts, value, flags, depth);
+       #endif
+    }
+
+    int drain(std::vector<TraceRecord>& out)
+    {
+        auto& reg = registry();
+        const juce::ScopedLock sl(reg.lock);   // one drainer at a time keeps each ring single-consumer
+
+        int total = 0;
+        TraceRecord chunk[256];
+        for (auto* ring : reg.rings)
+        {
+            int n;
+            while ((n = ring->read(chunk, (int)std::size(chunk))) > 0)
+            {
+                out.insert(out.end(), chunk, chunk + n);
+                total += n;
+            }
+        }
+        return total;
+    }
+
+    bool appendToFile(const juce::File& file, const std::vector<TraceRecord>& records)
+    {
+        const bool isNew = !file.existsAsFile() || file.getSize() == 0;
+        juce::FileOutputStream os(file);
+        if (!os.openedOk())
+            return false;
+
+        if (isNew)
+        {
+            os.write("PMTR", 4);
+            os.writeInt(1);                          // format version
+            os.writeInt((int)sizeof(TraceRecord));
+        }
+
+        os.write(records.data(), records.size() * sizeof(TraceRecord));
+        return true;
+    }
+
+    int drainToFile(const juce::File& file)
+    {
+        std::vector<TraceRecord> pending;
+        if (drain(pending) == 0 || !appendToFile(file, pending))
+            return 0;
+        return (int)pending.size();
+    }
+
+    juce::String describe(const TraceRecord& r)
+    {
+        juce::String s;
+        s << juce::String(juce::Time::highResolutionTicksToSeconds(r.ticks) * 1000.0, 3) << " ms"
+          << " [t" << (int)r.thread << "] " << eventName(r.event)
+          << ": input=" << (int)r.inputPitch << " generated=" << (int)r.generatedPitch;
+
+        if (r.interval >= 0)
+            s << " (" << IntervalTables::intervalNames[r.interval] << ")";
+        if (r.event == TraceEvent::Generated || r.event == TraceEvent::Voicing)
+            s << " nodes=" << r.attempts << " depth=" << (int)r.depth
+              << ((r.flags & TraceFlags::legal) ? "" : " illegal")
+              << ((r.flags & TraceFlags::speculated) ? " speculated" : "");
+        if (r.event == TraceEvent::Alternative)
+            s << " score=" << r.value;
+        return s;
+    }
+
+    juce::uint64 droppedRecords()
+    {
+        auto& reg = registry();
+        const juce::ScopedLock sl(reg.lock);
+
+        juce::uint64 total = 0;
+        for (auto* ring : reg.rings)
+            total += ring->getDropped();
+        return total;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Structured engine tracing. PM_TRACE writes a fixed-size binary record into a
+// ring owned by the calling thread (wait-free, no locks, no allocation after the
+// thread's first record). TraceView drains the rings to a file and a debug view.
+// In release builds PM_TRACE expands to nothing and its arguments are not evaluated.
+#ifndef POLYMUSE_TRACE
+ #if JUCE_DEBUG
+  #define POLYMUSE_TRACE 1
+ #else
+  #define POLYMUSE_TRACE 0
+ #endif
+#endif
+
+enum class TraceEvent : juce::uint8
+{
+    Generated,          // search answered: attempts = nodes expanded, depth = lookahead reached
+    NoLegalCandidate,   // every candidate broke a rule; best-scoring note used
+    Committed,          // pair recorded in the history
+    NoteOff,            // held generated note released
+    NoMapping,          // note-off for an input with no generated note
+    Voicing,            // multi-voice chord: generated = outer voice
+    Alternative         // suggestAlternativeNote result: value = combined score
+};
+
+namespace TraceFlags
+{
+    constexpr juce::uint8 legal = 1;
+    constexpr juce::uint8 speculated = 2;
+    constexpr juce::uint8 above = 4;
+}
+
+struct TraceRecord
+{
+    juce::int64 ticks = 0;          // juce::Time high-resolution ticks
+    juce::int32 attempts = 0;
+    float value = 0.0f;
+    juce::uint16 thread = 0;        // ring the record came from
+    TraceEvent event = TraceEvent::Generated;
+    juce::int8 inputPitch = -1;
+    juce::int8 generatedPitch = -1;
+    juce::int8 interval = -1;       // interval class, -1 if either pitch is missing
+    juce::uint8 flags = 0;
+    juce::uint8 depth = 0;
+};
+
+static_assert(sizeof(TraceRecord) == 24, "trace files assume 24-byte records");
+
+// Single-producer (owning thread) / single-consumer (drainer) ring of records.
+// When full, new records are dropped and counted rather than blocking the writer,
+// so the rings have to be drained while the session runs (TraceView does).
+class TraceRing
+{
+public:
+    static constexpr juce::uint32 capacity = 4096;   // power of two
+
+    explicit TraceRing(juce::uint16 threadIndex) : thread(threadIndex) {}
+
+    void write(TraceRecord record);
+    int read(TraceRecord* out, int maxRecords);
+    juce::uint64 getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::array<TraceRecord, capacity> records;
+    std::atomic<juce::uint32> writePos { 0 }, readPos { 0 };
+    std::atomic<juce::uint64> dropped { 0 };
+    const juce::uint16 thread;
+};
+
+namespace Trace
+{
+    void record(TraceEvent event, int inputPitch, int generatedPitch,
+                int attempts = 0, float value = 0.0f, juce::uint8 flags = 0, int depth = 0);
+
+    // Moves every pending record (all threads) into out; returns how many were added.
+    int drain(std::vector<TraceRecord>& out);
+
+    // Appends records to a binary file ("PMTR" header, then raw records); false if it can't be opened
+    bool appendToFile(const juce::File& file, const std::vector<TraceRecord>& records);
+
+    // Drains pending records and appends them to the file; returns how many were written
+    int drainToFile(const juce::File& file);
+
+    // One readable line per record, for a debug view
+    juce::String describe(const TraceRecord& record);
+
+    juce::uint64 droppedRecords();
+}
+
+#if POLYMUSE_TRACE
+ #define PM_TRACE(...) Trace::record(__VA_ARGS__)
+#else
+ #define PM_TRACE(...) ((void)0)
+#endif
@@ -0,0 +1,65 @@
+#include "TraceView.h"
+
+TraceView::TraceView(const juce::File& traceFile) : file(traceFile)
+{
+    text.setMultiLine(true);
+    text.setReadOnly(true);
+    text.setCaretVisible(false);
+    text.setScrollbarsShown(true);
+    text.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    text.setColour(juce::TextEditor::backgroundColourId, juce::Colour::fromRGB(20, 20, 20).withAlpha(0.92f));
+    text.setColour(juce::TextEditor::textColourId, juce::Colours::lightgreen);
+    addAndMakeVisible(text);
+
+    pending.reserve(TraceRing::capacity);
+    startTimer(drainIntervalMs);
+}
+
+TraceView::~TraceView()
+{
+    stopTimer();
+    flush();
+}
+
+void TraceView::resized()
+{
+    text.setBounds(getLocalBounds());
+}
+
+void TraceView::flush()
+{
+    pending.clear();
+    if (Trace::drain(pending) > 0)
+        Trace::appendToFile(file, pending);
+}
+
+void TraceView::timerCallback()
+{
+    flush();
+
+    const auto dropped = Trace::droppedRecords();
+    if (pending.empty() && dropped == lastDropped)
+        return;
+
+    const size_t first = pending.size() > (size_t)maxLines ? pending.size() - maxLines : 0;
+    for (size_t i = first; i < pending.size(); ++i)
+        lines.add(Trace::describe(pending[i]));
+
+    if (dropped != lastDropped)
+    {
+        lines.add("-- " + juce::String((juce::int64)(dropped - lastDropped)) + " records dropped (ring full) --");
+        lastDropped = dropped;
+    }
+
+    if (lines.size() > maxLines)
+        lines.removeRange(0, lines.size() - maxLines);
+
+    if (isShowing())
+        showLines();
+}
+
+void TraceView::showLines()
+{
+    text.setText(lines.joinIntoString("\n"), false);
+    text.moveCaretToEnd();
+}
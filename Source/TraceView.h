@@ -0,0 +1,33 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <vector>
+#include "TraceRing.h"
+
+// Debug view of the engine trace. Drains every thread's ring on a timer so a long
+// session never fills them, appends what it drained to the trace file and shows the
+// most recent records, newest last.
+class TraceView : public juce::Component, private juce::Timer
+{
+public:
+    explicit TraceView(const juce::File& traceFile);
+    ~TraceView() override;
+
+    void resized() override;
+    void visibilityChanged() override { showLines(); }
+
+    // Drains and writes whatever is still pending, e.g. on shutdown
+    void flush();
+
+private:
+    void timerCallback() override;
+    void showLines();
+
+    static constexpr int maxLines = 200;
+    static constexpr int drainIntervalMs = 250;   // 4096 records per ring last far longer
+
+    const juce::File file;
+    std::vector<TraceRecord> pending;
+    juce::StringArray lines;
+    juce::uint64 lastDropped = 0;
+    juce::TextEditor text;
+};
@@ -0,0 +1,220 @@
+#include "VoiceLeadingSearch.h"
+#include "IntervalTables.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+    struct VoiceRange { int low, high; };
+
+    // Bass upwards, indexed by voice count
+    constexpr VoiceRange rangesFor[VoiceLeadingSearch::maxVoices + 1][VoiceLeadingSearch::maxVoices] = {
+        {},
+        {},
+        { {40, 60}, {60, 81} },
+        { {40, 60}, {52, 72}, {60, 81} },
+        { {40, 60}, {48, 67}, {55, 74}, {60, 81} }
+    };
+
+    constexpr VoiceRange relaxedRange { 24, 96 };
+
+    constexpr uint16_t consonantClasses = (1 << 0) | (1 << 3) | (1 << 4) | (1 << 7) | (1 << 8) | (1 << 9);
+    constexpr uint16_t upperVoiceClasses = consonantClasses | (1 << 5);   // fourths are fine above the bass
+
+    constexpr int maxBassGap = 19;    // bass to tenor may span a twelfth
+    constexpr int maxUpperGap = 12;   // adjacent upper voices within an octave
+}
+
+PitchMask PitchMask::range(int low, int high)
+{
+    PitchMask m;
+    low = std::max(low, 0);
+    high = std::min(high, 127);
+    for (int p = low; p <= high; ++p)
+    {
+        if (p < 64) m.lo |= (uint64_t)1 << p;
+        else        m.hi |= (uint64_t)1 << (p - 64);
+    }
+    return m;
+}
+
+PitchMask PitchMask::intervalPattern(int reference, uint16_t classes)
+{
+    PitchMask m;
+    for (int p = 0; p < 128; ++p)
+    {
+        if ((classes >> IntervalTables::intervalClass(p - reference)) & 1)
+        {
+            if (p < 64) m.lo |= (uint64_t)1 << p;
+            else        m.hi |= (uint64_t)1 << (p - 64);
+        }
+    }
+    return m;
+}
+
+struct VoiceLeadingSearch::State
+{
+    int numVoices = 0;
+    bool inputIsBass = true;
+    int inputVoice = 0;
+    bool strict = true;
+    const Chord* previous = nullptr;
+
+    int order[maxVoices] = {};
+    int numGenerated = 0;
+    int pitches[maxVoices] = { -1, -1, -1, -1 };
+    PitchMask ranges[maxVoices];
+    PitchMask vsInputBass;    // allowed against the input when the pair includes the bass
+    PitchMask vsInputUpper;   // allowed against the input between upper voices
+
+    float cost = 0.0f;
+    int nodes = 0;
+    Result* best = nullptr;
+};
+
+bool VoiceLeadingSearch::pairAllowed(const State& s, int voice, int pitch, float& cost) const
+{
+    const bool voiceLeading = s.previous != nullptr;
+
+    for (int j = 0; j < s.numVoices; ++j)
+    {
+        const int other = s.pitches[j];
+        if (j == voice || other < 0)
+            continue;
+
+        const int lowV = std::min(voice, j);
+        const int highV = std::max(voice, j);
+        const int lowP = (lowV == voice) ? pitch : other;
+        const int highP = (highV == voice) ? pitch : other;
+
+        const int cls = IntervalTables::intervalClass(highP - lowP);
+        const bool allowed = (lowV == 0) ? IntervalTables::isConsonant(highP - lowP)
+                                         : (IntervalTables::isConsonant(highP - lowP) || cls == 5);
+        if (!allowed)
+            return false;
+
+        if (voiceLeading)
+        {
+            const uint8_t motion = IntervalTables::motionViolations(s.previous->pitches[lowV], s.previous->pitches[highV],
+                                                                    lowP, highP);
+            if (s.strict && (motion & (IntervalTables::ParallelFifth | IntervalTables::ParallelOctave)))
+                return false;
+            if ((motion & IntervalTables::HiddenPerfect) && lowV == 0 && highV == s.numVoices - 1)
+                cost += 0.5f;   // hidden perfects between the outer voices
+        }
+    }
+
+    if (voiceLeading)
+    {
+        const int leap = std::abs(pitch - s.previous->pitches[voice]);
+        cost += 0.1f * (float)leap;
+        if (leap > 7) cost += 0.5f;
+    }
+
+    return true;
+}
+
+float VoiceLeadingSearch::chordCost(const State& s) const
+{
+    const int bass = s.pitches[0];
+    int classCount[12] = {};
+    for (int v = 0; v < s.numVoices; ++v)
+        ++classCount[IntervalTables::intervalClass(s.pitches[v] - bass)];
+
+    float cost = 0.0f;
+    const int thirds = classCount[3] + classCount[4];
+    if (thirds == 0) cost += 1.0f;               // incomplete triad
+    else if (thirds > 1) cost += 0.3f;           // doubled third
+    if (classCount[7] == 0 && classCount[8] == 0 && classCount[9] == 0)
+        cost += 0.2f;
+    return cost;
+}
+
+void VoiceLeadingSearch::assign(State& s, int step) const
+{
+    if (step == s.numGenerated)
+    {
+        const float total = s.cost + chordCost(s);
+        if (total < s.best->cost)
+        {
+            s.best->cost = total;
+            s.best->chord.numVoices = s.numVoices;
+            std::copy(s.pitches, s.pitches + s.numVoices, s.best->chord.pitches);
+        }
+        return;
+    }
+
+    const int voice = s.order[step];
+    const int neighbour = s.inputIsBass ? voice - 1 : voice + 1;
+    const int n = s.pitches[neighbour];
+    const int maxGap = (std::min(voice, neighbour) == 0) ? maxBassGap : maxUpperGap;
+
+    const PitchMask spacing = s.inputIsBass ? PitchMask::range(n + 1, n + maxGap)
+                                            : PitchMask::range(n - maxGap, n - 1);
+    const bool pairWithBass = (voice == 0 || s.inputVoice == 0);
+    const PitchMask candidates = s.ranges[voice] & spacing & (pairWithBass ? s.vsInputBass : s.vsInputUpper);
+
+    candidates.forEach([&](int pitch) {
+        ++s.nodes;
+        float local = 0.0f;
+        if (!pairAllowed(s, voice, pitch, local))
+            return;
+        if (s.cost + local >= s.best->cost)
+            return;   // bound: costs only grow
+
+        s.pitches[voice] = pitch;
+        s.cost += local;
+        assign(s, step + 1);
+        s.cost -= local;
+        s.pitches[voice] = -1;
+    });
+}
+
+VoiceLeadingSearch::Result VoiceLeadingSearch::search(int inputPitch, int numVoices, bool inputIsBass,
+                                                      const Chord* previous) const
+{
+    Result result;
+    numVoices = std::clamp(numVoices, 2, maxVoices);
+
+    State s;
+    s.numVoices = numVoices;
+    s.inputIsBass = inputIsBass;
+    s.inputVoice = inputIsBass ? 0 : numVoices - 1;
+    s.previous = (previous != nullptr && previous->numVoices == numVoices) ? previous : nullptr;
+    s.pitches[s.inputVoice] = inputPitch;
+    s.vsInputBass = PitchMask::intervalPattern(inputPitch, consonantClasses);
+    s.vsInputUpper = PitchMask::intervalPattern(inputPitch, upperVoiceClasses);
+    s.best = &result;
+
+    for (int i = 0; i < numVoices - 1; ++i)
+        s.order[i] = inputIsBass ? i + 1 : numVoices - 2 - i;
+    s.numGenerated = numVoices - 1;
+
+    // Strict pass first; if nothing fits, allow parallels and widen the ranges
+    for (int pass = 0; pass < 2 && result.chord.numVoices == 0; ++pass)
+    {
+        s.strict = (pass == 0);
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const VoiceRange r = s.strict ? rangesFor[numVoices][v] : relaxedRange;
+            s.ranges[v] = PitchMask::range(r.low, r.high);
+        }
+
+        result.cost = std::numeric_limits<float>::max();
+        assign(s, 0);
+        result.legal = s.strict && result.chord.numVoices > 0;
+    }
+
+    if (result.chord.numVoices == 0)
+    {
+        // Input far outside every range: stack octaves on the input
+        result.chord.numVoices = numVoices;
+        for (int v = 0; v < numVoices; ++v)
+            result.chord.pitches[v] = std::clamp(inputPitch + (v - s.inputVoice) * 12, 0, 127);
+        result.cost = 0.0f;
+    }
+
+    result.nodesExpanded = s.nodes;
+    return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+// 128-bit set of MIDI pitches, used to prune candidate pitches per voice
+struct PitchMask
+{
+    uint64_t lo = 0;   // pitches 0-63
+    uint64_t hi = 0;   // pitches 64-127
+
+    static PitchMask range(int low, int high);                    // inclusive, clamped to 0..127
+    static PitchMask intervalPattern(int reference, uint16_t classes); // pitches whose class vs reference is in the 12-bit set
+
+    PitchMask operator& (const PitchMask& o) const { return { lo & o.lo, hi & o.hi }; }
+    bool empty() const { return (lo | hi) == 0; }
+
+    // Calls fn(pitch) for every set pitch in ascending order
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (uint64_t bits = lo; bits != 0; bits &= bits - 1)
+            fn(std::countr_zero(bits));
+        for (uint64_t bits = hi; bits != 0; bits &= bits - 1)
+            fn(64 + std::countr_zero(bits));
+    }
+};
+
+// Joint search for 3- and 4-voice textures around a single input note.
+// Voices are numbered bass (0) upwards; the input fills either the bass or the top voice.
+// Every pair of voices is checked for consonance and parallel perfects against the
+// previous chord, and branches are pruned with per-voice range and spacing masks.
+class VoiceLeadingSearch {
+public:
+    static constexpr int maxVoices = 4;
+
+    struct Chord
+    {
+        int pitches[maxVoices] = { -1, -1, -1, -1 };
+        int numVoices = 0;
+    };
+
+    struct Result
+    {
+        Chord chord;
+        float cost = 0.0f;
+        int nodesExpanded = 0;
+        bool legal = false;   // false if no voicing passed every pairwise check
+    };
+
+    // previous may be null (first chord of a phrase) or have a different voice count.
+    Result search(int inputPitch, int numVoices, bool inputIsBass, const Chord* previous) const;
+
+private:
+    struct State;
+
+    void assign(State& s, int step) const;
+    bool pairAllowed(const State& s, int voice, int pitch, float& cost) const;
+    float chordCost(const State& s) const;
+};
@@ -0,0 +1,89 @@
+// Checks that the note-on generation path never allocates.
+//
+//   PolyMuseAllocTest [--iterations N]
+//
+// Replaces the global operator new with one that counts calls made by this thread, warms
+// the engine up, then drives generateCounterpoint (with and without a time budget) and
+// noteOffForInput over a repeating scale. Fails with exit code 1 if any of those calls
+// allocated.
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include "CounterpointEngine.h"
+
+namespace
+{
+    // Only the thread under test counts, and only while armed
+    thread_local bool armed = false;
+    thread_local long allocations = 0;
+
+    void* allocate(std::size_t size)
+    {
+        if (armed)
+            ++allocations;
+        if (void* p = std::malloc(size != 0 ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    constexpr int scale[] = { 60, 62, 64, 65, 67, 69, 71, 72, 71, 69, 67, 65, 64, 62 };
+
+    void playNote(CounterpointEngine& engine, int i)
+    {
+        const int pitch = scale[i % (int)std::size(scale)];
+        const auto noteOn = juce::MidiMessage::noteOn(1, pitch, (juce::uint8)100);
+        engine.generateCounterpoint(noteOn);
+        engine.noteOffForInput(pitch);
+        engine.generateCounterpoint(noteOn, 5);
+        engine.noteOffForInput(pitch);
+        engine.noteOffForInput(3);           // a note that was never played
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: PolyMuseAllocTest [--iterations N]" << std::endl;
+        return 2;
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[])
+{
+    int iterations = 1000;
+    if (argc == 3 && std::strcmp(argv[1], "--iterations") == 0)
+        iterations = juce::jmax(1, std::atoi(argv[2]));
+    else if (argc != 1)
+        return usage();
+
+    CounterpointEngine engine;
+    engine.setSpeculationEnabled(false);     // speculation allocates on its own thread by design
+    engine.setModelBlending(true);           // cover the model stage, even with the mock
+
+    // First calls size the engine's buffers and the trace ring
+    for (int i = 0; i < 50; ++i)
+        playNote(engine, i);
+
+    armed = true;
+    for (int i = 0; i < iterations; ++i)
+        playNote(engine, i);
+    armed = false;
+
+    std::cout << iterations << " notes, " << allocations << " allocation(s) on the note-on path" << std::endl;
+    if (allocations != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Whole-score rule check for MIDI exercises.
+//
+//   PolyMuseAnalyze <midi-file> [--summary] [--rules <preset>]
+//   PolyMuseAnalyze --solve <midi-file> [--track N] [--below] [--out <midi-file>]
+//   PolyMuseAnalyze --bench [notes-per-voice]
+//
+// Prints every rule violation between every pair of voices (see ScoreAnalyzer), then a
+// count per rule; --summary prints only the counts. --rules picks one of RuleChecker's
+// presets (strict by default). --solve takes track N (the first track with notes by
+// default) as a cantus firmus, writes PhraseSolver's counterpoint above it (or below)
+// next to it in a new file (<midi-file>-solved.mid by default), and checks the pair
+// with the strict rules. --bench builds a four-voice score in memory (2500 notes per
+// voice by default) and times alignment and the rule pass.
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstring>
+#include <iostream>
+#include "PhraseSolver.h"
+#include "ScoreAnalyzer.h"
+
+namespace
+{
+    // Four voices in different rhythms, each stepping and leaping around its own register
+    juce::MidiFile makeBenchScore(int notesPerVoice)
+    {
+        constexpr int ticksPerQuarter = 480;
+        constexpr int lowest[] = { 40, 52, 60, 67 };
+        constexpr int lengths[] = { 960, 480, 480, 240 };
+        constexpr int steps[] = { 2, -1, 3, -2, 5, -4, 1, -3 };
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote(ticksPerQuarter);
+        juce::Random random(1);
+
+        for (int v = 0; v < 4; ++v)
+        {
+            juce::MidiMessageSequence track;
+            int pitch = lowest[v] + 6;
+            for (int i = 0; i < notesPerVoice; ++i)
+            {
+                pitch = juce::jlimit(lowest[v], lowest[v] + 12, pitch + steps[random.nextInt(8)]);
+                const double on = (double)(i * lengths[v]);
+                track.addEvent(juce::MidiMessage::noteOn(v + 1, pitch, (juce::uint8)90), on);
+                track.addEvent(juce::MidiMessage::noteOff(v + 1, pitch), on + lengths[v]);
+            }
+            file.addTrack(track);
+        }
+        return file;
+    }
+
+    int bench(int notesPerVoice)
+    {
+        const juce::MidiFile file = makeBenchScore(notesPerVoice);
+        ScoreAnalyzer analyzer;
+
+        ScoreReport report = analyzer.analyse(file);   // warm up
+        double align = 0.0, rules = 0.0;
+        constexpr int runs = 10;
+        for (int i = 0; i < runs; ++i)
+        {
+            report = analyzer.analyse(file);
+            align += report.alignMillis;
+            rules += report.rulesMillis;
+        }
+
+        std::cout << report.numVoices << " voices, " << report.numNotes << " notes, " << report.numSonorities
+                  << " sonorities, " << report.violations.size() << " violations, "
+                  << juce::SystemStats::getNumCpus() << " CPU(s)" << std::endl
+                  << "Align " << juce::String(align / runs, 2) << " ms, rules " << juce::String(rules / runs, 2)
+                  << " ms, total " << juce::String((align + rules) / runs, 2) << " ms" << std::endl;
+        return 0;
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: PolyMuseAnalyze <midi-file> [--summary] [--rules <preset>]" << std::endl
+                  << "       PolyMuseAnalyze --solve <midi-file> [--track N] [--below] [--out <midi-file>]" << std::endl
+                  << "       PolyMuseAnalyze --bench [notes-per-voice]" << std::endl
+                  << "presets:" << std::endl;
+        for (const auto& p : RuleChecker::presets())
+            std::cerr << "  " << p.name << "  " << p.description << std::endl;
+        return 1;
+    }
+
+    void printCounts(const ScoreReport& report)
+    {
+        for (int k = 0; k <= (int)ViolationKind::Other; ++k)
+            if (const int n = report.count((ViolationKind)k); n > 0)
+                std::cout << RuleChecker::kindName((ViolationKind)k) << ": " << n << std::endl;
+    }
+
+    bool readMidi(const char* path, juce::MidiFile& midi, juce::File& file)
+    {
+        file = juce::File::getCurrentWorkingDirectory().getChildFile(juce::String::fromUTF8(path));
+        juce::FileInputStream in(file);
+        if (in.openedOk() && midi.readFrom(in))
+            return true;
+
+        std::cerr << "Could not read " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    // The cantus track and the solved line as a two-voice file in the input's time format.
+    // Solved note i lasts from cantus onset i to the next one (the last to the track's end).
+    juce::MidiFile withSolvedLine(const juce::MidiFile& midi, int trackIndex, const std::vector<int>& line)
+    {
+        juce::MidiFile out(midi);
+        out.clear();
+
+        juce::MidiMessageSequence conductor;
+        midi.findAllTempoEvents(conductor);
+        midi.findAllTimeSigEvents(conductor);
+        conductor.sort();
+        out.addTrack(conductor);
+
+        const auto& cantus = *midi.getTrack(trackIndex);
+        out.addTrack(cantus);
+
+        std::vector<double> onsets;              // one per cantus note, as cantusFromMidiTrack counts them
+        for (const auto* event : cantus)
+            if (event->message.isNoteOn() && (onsets.empty() || event->message.getTimeStamp() != onsets.back()))
+                onsets.push_back(event->message.getTimeStamp());
+
+        juce::MidiMessageSequence solved;
+        for (size_t i = 0; i < line.size() && i < onsets.size(); ++i)
+        {
+            const double end = i + 1 < onsets.size() ? onsets[i + 1] : juce::jmax(onsets[i] + 1.0, cantus.getEndTime());
+            solved.addEvent(juce::MidiMessage::noteOn(2, line[i], (juce::uint8)90), onsets[i]);
+            solved.addEvent(juce::MidiMessage::noteOff(2, line[i]), end);
+        }
+        solved.updateMatchedPairs();
+        out.addTrack(solved);
+        return out;
+    }
+
+    int solve(int argc, char* argv[])
+    {
+        if (argc < 3)
+            return usage();
+
+        int trackIndex = -1;
+        bool above = true;
+        juce::String outPath;
+        for (int i = 3; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--track") == 0 && i + 1 < argc)
+                trackIndex = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--below") == 0)
+                above = false;
+            else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+                outPath = juce::String::fromUTF8(argv[++i]);
+            else
+                return usage();
+        }
+
+        juce::MidiFile midi;
+        juce::File file;
+        if (!readMidi(argv[2], midi, file))
+            return 1;
+
+        for (int t = 0; t < midi.getNumTracks() && trackIndex < 0; ++t)
+            if (!PhraseSolver::cantusFromMidiTrack(midi, t).empty())
+                trackIndex = t;
+
+        const auto cantus = PhraseSolver::cantusFromMidiTrack(midi, trackIndex);
+        if (cantus.empty())
+        {
+            std::cerr << "No notes in track " << trackIndex << std::endl;
+            return 1;
+        }
+
+        PhraseSolver solver;
+        const auto start = juce::Time::getHighResolutionTicks();
+        const auto line = solver.solve(cantus, above);
+        const double millis = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+
+        const juce::File outFile = outPath.isNotEmpty()
+            ? juce::File::getCurrentWorkingDirectory().getChildFile(outPath)
+            : file.getSiblingFile(file.getFileNameWithoutExtension() + "-solved.mid");
+        const juce::MidiFile result = withSolvedLine(midi, trackIndex, line);
+        outFile.deleteFile();
+        juce::FileOutputStream os(outFile);
+        if (!os.openedOk() || !result.writeTo(os))
+        {
+            std::cerr << "Could not write " << outFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Track " << trackIndex << ": " << cantus.size() << " cantus notes, solved "
+                  << (above ? "above" : "below") << " in " << juce::String(millis, 2) << " ms, cost "
+                  << juce::String(solver.getLastCost(), 2) << std::endl;
+
+        // The written pair, checked the way any exercise is
+        const ScoreReport report = ScoreAnalyzer().analyse(result);
+        std::cout << report.violations.size() << " violation(s)" << std::endl;
+        printCounts(report);
+        std::cout << "Wrote " << outFile.getFullPathName() << std::endl;
+        return 0;
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+        return usage();
+
+    if (std::strcmp(argv[1], "--bench") == 0)
+        return bench(argc > 2 ? juce::jmax(1, std::atoi(argv[2])) : 2500);
+    if (std::strcmp(argv[1], "--solve") == 0)
+        return solve(argc, argv);
+
+    ScoreAnalyzer analyzer;
+    bool summaryOnly = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--summary") == 0)
+            summaryOnly = true;
+        else if (std::strcmp(argv[i], "--rules") == 0 && i + 1 < argc && analyzer.setRulePreset(argv[i + 1]))
+            ++i;
+        else
+            return usage();
+    }
+
+    juce::MidiFile midi;
+    juce::File file;
+    if (!readMidi(argv[1], midi, file))
+        return 1;
+
+    const ScoreReport report = analyzer.analyse(midi);
+    if (summaryOnly)
+    {
+        std::cout << report.numVoices << " voices, " << report.numNotes << " notes: " << report.violations.size()
+                  << " violation(s)" << std::endl;
+        printCounts(report);
+    }
+    else
+    {
+        std::cout << report.toText();
+    }
+
+    std::cout << "Analysed in " << juce::String(report.alignMillis + report.rulesMillis, 2) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,345 @@
+// Stand-in model server for the RemoteModel backend.
+//
+//   PolyMuseModelServer [--socket path] [--model file]
+//   PolyMuseModelServer --bench [N] [--model file]
+//   PolyMuseModelServer --cache-bench [N] [--model file]
+//   PolyMuseModelServer --neural-bench [N]
+//
+// Serves MockModel (or the .gru / .ngram model given with --model) on a Unix domain
+// socket, by default the one ModelBridge::createDefault() looks for, until interrupted.
+// --bench starts a copy of itself as a child process on a private socket, connects a
+// RemoteModel to it and reports round-trip latency against the same model in process.
+// --cache-bench plays a scale up and down for N notes, scores each note's candidates
+// through CachingModelBridge and straight from the model, and reports the cache's hit
+// rate and both timings.
+// --neural-bench writes a NeuralModel with random weights to a temporary .gru file,
+// checks that a session scores every prefix of a 32-note line the same as stateless
+// calls, then times scoreCandidates and scoreProbabilities on N different 32-note
+// contexts with 10 candidates, and a session step per note.
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include "CachingModelBridge.h"
+#include "NeuralModel.h"
+#include "RemoteModel.h"
+
+namespace
+{
+    std::atomic<bool> interrupted { false };
+
+    void onSignal(int) { interrupted = true; }
+
+    std::unique_ptr<ModelBridge> makeModel(const juce::String& modelPath)
+    {
+        if (modelPath.isEmpty())
+            return ModelBridge::createMock();
+
+        const juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile(modelPath);
+        return file.hasFileExtension("gru") ? ModelBridge::createNeural(file) : ModelBridge::createNGram(file);
+    }
+
+    struct Timings
+    {
+        double mean = 0.0, p50 = 0.0, p99 = 0.0;
+    };
+
+    template <typename Fn>
+    Timings time(int iterations, Fn&& fn)
+    {
+        std::vector<double> micros;
+        micros.reserve((size_t)iterations);
+        for (int i = 0; i < iterations; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            fn(i);
+            micros.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e6);
+        }
+
+        std::sort(micros.begin(), micros.end());
+        Timings t;
+        for (double m : micros)
+            t.mean += m;
+        t.mean /= (double)juce::jmax(1, iterations);
+        t.p50 = micros[micros.size() / 2];
+        t.p99 = micros[juce::jmin(micros.size() - 1, micros.size() * 99 / 100)];
+        return t;
+    }
+
+    void report(const char* label, const Timings& t)
+    {
+        std::cout << label << "mean " << juce::String(t.mean, 1) << " us, p50 " << juce::String(t.p50, 1)
+                  << " us, p99 " << juce::String(t.p99, 1) << " us" << std::endl;
+    }
+
+    int bench(int iterations, const juce::String& modelPath)
+    {
+        const juce::String socketPath = juce::File::getSpecialLocation(juce::File::tempDirectory)
+            .getChildFile("polymuse-bench-" + juce::String(juce::Random::getSystemRandom().nextInt(1000000)) + ".sock")
+            .getFullPathName();
+
+        juce::StringArray command { juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName(),
+                                    "--socket", socketPath };
+        if (modelPath.isNotEmpty())
+            command.addArray({ "--model", modelPath });
+
+        juce::ChildProcess server;
+        if (!server.start(command, 0))
+        {
+            std::cerr << "Could not start the server" << std::endl;
+            return 1;
+        }
+
+        std::unique_ptr<RemoteModel> remote;
+        for (int attempt = 0; attempt < 100 && remote == nullptr; ++attempt)
+        {
+            juce::Thread::sleep(20);
+            remote = RemoteModel::connect(socketPath, 1000);
+        }
+
+        auto local = makeModel(modelPath);
+        if (remote == nullptr || local == nullptr)
+        {
+            std::cerr << "Could not " << (local == nullptr ? "load the model" : "connect to the server") << std::endl;
+            server.kill();
+            return 1;
+        }
+
+        // A 16-note line and the 10 candidates around its last note
+        std::vector<ContextNote> context;
+        for (int i = 0; i < 16; ++i)
+            context.push_back({ 60 + (i * 5) % 12, i * 0.5, i * 0.5 + 0.5 });
+        std::vector<int> candidates;
+        for (int c = -5; c < 5; ++c)
+            candidates.push_back(context.back().pitch + c);
+
+        std::vector<float> remoteProbs(candidates.size()), localProbs(candidates.size());
+        float maxDiff = 0.0f;
+        remote->scoreProbabilities(context, candidates, 0, true, remoteProbs);   // warm up
+        local->scoreProbabilities(context, candidates, 0, true, localProbs);
+        for (size_t i = 0; i < candidates.size(); ++i)
+            maxDiff = juce::jmax(maxDiff, std::abs(remoteProbs[i] - localProbs[i]));
+
+        std::cout << "Remote context window " << remote->contextWindow() << ", largest difference from in-process "
+                  << maxDiff << std::endl;
+
+        report("In-process    ", time(iterations, [&](int) {
+            local->scoreProbabilities(context, candidates, 0, true, localProbs);
+        }));
+        report("Round trip    ", time(iterations, [&](int) {
+            remote->scoreProbabilities(context, candidates, 0, true, remoteProbs);
+        }));
+
+        // One candidate per request, as the stateless inference path sends them
+        std::vector<ScoreRequest> requests;
+        for (size_t i = 0; i < candidates.size(); ++i)
+            requests.push_back({ context, { candidates.data() + i, 1 } });
+        report("Batch of 10   ", time(iterations, [&](int) {
+            remote->scoreBatch(requests, 0, true, remoteProbs);
+        }));
+
+        remote.reset();
+        server.kill();
+        juce::File(socketPath).deleteFile();
+        return 0;
+    }
+
+    int cacheBench(int notes, const juce::String& modelPath)
+    {
+        auto loaded = makeModel(modelPath);
+        if (loaded == nullptr)
+        {
+            std::cerr << "Could not load the model" << std::endl;
+            return 1;
+        }
+        const auto model = ModelBridge::share(std::move(loaded));
+
+        // The line so far is the context, as much of it as the model reads, and the
+        // candidates are the 10 pitches around the next note
+        constexpr int scale[] = { 60, 62, 64, 65, 67, 69, 71, 72, 71, 69, 67, 65, 64, 62 };
+        std::vector<ContextNote> line;
+        for (int i = 0; i <= notes; ++i)
+            line.push_back({ scale[i % (int)std::size(scale)], i * 0.5, i * 0.5 + 0.5 });
+
+        const size_t window = (size_t)juce::jmax(1, model->contextWindow());
+        std::array<int, 10> candidates;
+        auto prepare = [&](int i) {
+            const size_t end = (size_t)i + 1;
+            for (int c = 0; c < (int)candidates.size(); ++c)
+                candidates[(size_t)c] = line[end].pitch - 5 + c;
+            return std::span<const ContextNote>(line).subspan(end - juce::jmin(end, window), juce::jmin(end, window));
+        };
+
+        CachingModelBridge cache(model);
+        std::array<float, 10> cached, direct;
+        int mismatches = 0;
+        for (int i = 0; i < notes; ++i)
+        {
+            const auto context = prepare(i);
+            cache.scoreProbabilities(context, candidates, 0, true, cached);
+            model->scoreProbabilities(context, candidates, 0, true, direct);
+            mismatches += cached == direct ? 0 : 1;
+        }
+        cache.clear();
+
+        const Timings withCache = time(notes, [&](int i) {
+            cache.scoreProbabilities(prepare(i), candidates, 0, true, cached);
+        });
+        const auto stats = cache.getStats();
+        const Timings withoutCache = time(notes, [&](int i) {
+            model->scoreProbabilities(prepare(i), candidates, 0, true, direct);
+        });
+
+        std::cout << notes << " notes, context window " << window << ": " << juce::String(stats.hitRate() * 100.0, 1)
+                  << "% hits, " << stats.entries << " entries, " << juce::String((double)stats.bytes / 1024.0, 1)
+                  << " KB, " << mismatches << " mismatch(es) against the model" << std::endl;
+        report("Cached        ", withCache);
+        report("Model         ", withoutCache);
+        return mismatches > 0 ? 1 : 0;
+    }
+
+    int neuralBench(int iterations)
+    {
+        const juce::File file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+            .getChildFile("polymuse-bench-" + juce::String(juce::Random::getSystemRandom().nextInt(1000000)) + ".gru");
+        const NeuralModel::Dims dims;
+        if (!NeuralModel::write(NeuralModel::FloatWeights::random(dims, 1), file))
+        {
+            std::cerr << "Could not write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+        auto model = NeuralModel::open(file);
+        if (model == nullptr)
+        {
+            std::cerr << "Could not open " << file.getFullPathName() << std::endl;
+            file.deleteFile();
+            return 1;
+        }
+
+        // A random walk in C major; each timed call reads a different 32-note window of it,
+        // so the model's cached recurrent pass never applies
+        constexpr int window = NeuralModel::maxContext;
+        std::vector<ContextNote> line;
+        juce::Random random(2);
+        int pitch = 64;
+        for (int i = 0; i < iterations + window; ++i)
+        {
+            pitch = juce::jlimit(55, 79, pitch + random.nextInt(7) - 3);
+            line.push_back({ pitch, i * 0.5, i * 0.5 + 0.5 });
+        }
+
+        std::vector<int> candidates(10);
+        auto candidatesAfter = [&](int last) {
+            for (int c = 0; c < (int)candidates.size(); ++c)
+                candidates[(size_t)c] = last - 5 + c;
+        };
+
+        // The session steps once per note; a stateless call runs the whole prefix
+        std::vector<float> sessionProbs(candidates.size()), statelessProbs(candidates.size());
+        auto session = model->createSession(0, true);
+        float maxDiff = 0.0f;
+        for (int n = 1; n <= window; ++n)
+        {
+            session->append(line[(size_t)n - 1]);
+            candidatesAfter(line[(size_t)n - 1].pitch);
+            session->score(candidates, sessionProbs);
+            model->scoreProbabilities(std::span<const ContextNote>(line).first((size_t)n), candidates, 0, true, statelessProbs);
+            for (size_t i = 0; i < candidates.size(); ++i)
+                maxDiff = juce::jmax(maxDiff, std::abs(sessionProbs[i] - statelessProbs[i]));
+        }
+
+        std::cout << "Kernel " << NeuralKernels::activeKernelName() << ", hidden " << dims.hidden << ", "
+                  << window << "-note contexts, " << candidates.size() << " candidates; session vs stateless "
+                  << "largest difference " << maxDiff << std::endl;
+
+        std::vector<ContextNote> context;
+        context.reserve((size_t)window);
+        report("scoreCandidates    ", time(iterations, [&](int i) {
+            context.assign(line.begin() + i, line.begin() + i + window);
+            candidatesAfter(context.back().pitch);
+            model->scoreCandidates(context, candidates, 0, true);
+        }));
+        report("scoreProbabilities ", time(iterations, [&](int i) {
+            const auto slice = std::span<const ContextNote>(line).subspan((size_t)i, (size_t)window);
+            candidatesAfter(slice.back().pitch);
+            model->scoreProbabilities(slice, candidates, 0, true, statelessProbs);
+        }));
+        session->reset();
+        report("Session step       ", time(iterations, [&](int i) {
+            session->append(line[(size_t)i]);
+            candidatesAfter(line[(size_t)i].pitch);
+            session->score(candidates, sessionProbs);
+        }));
+
+        session.reset();
+        model.reset();
+        file.deleteFile();
+        return maxDiff == 0.0f ? 0 : 1;
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: PolyMuseModelServer [--socket path] [--model file]" << std::endl
+                  << "       PolyMuseModelServer --bench [N] [--model file]" << std::endl
+                  << "       PolyMuseModelServer --cache-bench [N] [--model file]" << std::endl
+                  << "       PolyMuseModelServer --neural-bench [N]" << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    juce::String socketPath = RemoteModelProtocol::getDefaultSocketPath();
+    juce::String modelPath;
+    int benchIterations = 0;
+    int cacheBenchNotes = 0;
+    int neuralBenchIterations = 0;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--socket" && i + 1 < args.size())
+            socketPath = args[++i];
+        else if (args[i] == "--model" && i + 1 < args.size())
+            modelPath = args[++i];
+        else if (args[i] == "--bench")
+            benchIterations = (i + 1 < args.size() && args[i + 1].containsOnly("0123456789")) ? juce::jmax(1, args[++i].getIntValue()) : 10000;
+        else if (args[i] == "--cache-bench")
+            cacheBenchNotes = (i + 1 < args.size() && args[i + 1].containsOnly("0123456789")) ? juce::jmax(1, args[++i].getIntValue()) : 10000;
+        else if (args[i] == "--neural-bench")
+            neuralBenchIterations = (i + 1 < args.size() && args[i + 1].containsOnly("0123456789")) ? juce::jmax(1, args[++i].getIntValue()) : 1000;
+        else
+            return usage();
+    }
+
+    if (benchIterations > 0)
+        return bench(benchIterations, modelPath);
+    if (cacheBenchNotes > 0)
+        return cacheBench(cacheBenchNotes, modelPath);
+    if (neuralBenchIterations > 0)
+        return neuralBench(neuralBenchIterations);
+
+    if (makeModel(modelPath) == nullptr)
+    {
+        std::cerr << "Could not load " << modelPath << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::cout << "Serving " << (modelPath.isEmpty() ? juce::String("the mock model") : modelPath)
+              << " on " << socketPath << std::endl;
+    if (!RemoteModelProtocol::serve(socketPath, [&] { return makeModel(modelPath); }, [] { return interrupted.load(); }))
+    {
+        std::cerr << "Could not listen on " << socketPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Headless trainer for the n-gram ModelBridge backend.
+//
+//   PolyMuseTrainer <midi-folder> <model-file> [--threads N] [--scaling]
+//
+// Files are streamed through juce::MidiFile by a pool of workers. Each worker counts
+// into its own NGramBuilder (a per-thread hash table shard), so there is no shared
+// state while counting; the shards are merged once at the end and written out.
+// --scaling repeats the counting pass with 1, 2, 4 ... N threads and reports speed-up.
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include "NGramModel.h"
+
+namespace
+{
+    struct TrainResult
+    {
+        std::vector<std::unique_ptr<NGramBuilder>> shards;
+        int filesRead = 0;
+        int filesFailed = 0;
+        double seconds = 0.0;
+    };
+
+    TrainResult countShards(const juce::Array<juce::File>& files, int numThreads)
+    {
+        TrainResult result;
+        std::atomic<int> next { 0 }, read { 0 }, failed { 0 };
+
+        for (int t = 0; t < numThreads; ++t)
+            result.shards.push_back(std::make_unique<NGramBuilder>());
+
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < numThreads; ++t)
+        {
+            workers.emplace_back([&, shard = result.shards[(size_t)t].get()] {
+                for (int i = next++; i < files.size(); i = next++)
+                {
+                    if (shard->addMidiFile(files.getReference(i)))
+                        ++read;
+                    else
+                        ++failed;
+                }
+            });
+        }
+
+        for (auto& w : workers)
+            w.join();
+
+        result.seconds = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+        result.filesRead = read;
+        result.filesFailed = failed;
+        return result;
+    }
+
+    juce::uint64 totalTokens(const TrainResult& r)
+    {
+        juce::uint64 tokens = 0;
+        for (const auto& shard : r.shards)
+            tokens += shard->getNumTokens();
+        return tokens;
+    }
+
+    void report(const char* label, int threads, const TrainResult& r)
+    {
+        const double secs = juce::jmax(r.seconds, 1.0e-9);
+        std::cout << label << threads << " thread(s): " << r.filesRead << " files in "
+                  << juce::String(r.seconds, 3) << " s, "
+                  << juce::String(r.filesRead / secs, 1) << " files/sec, "
+                  << (juce::int64)((double)totalTokens(r) / secs) << " tokens/sec" << std::endl;
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: PolyMuseTrainer <midi-folder> <model-file> [--threads N] [--scaling]" << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    int numThreads = juce::jmax(1, (int)std::thread::hardware_concurrency());
+    bool scaling = false;
+    juce::StringArray positional;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--threads" && i + 1 < args.size())
+            numThreads = juce::jmax(1, args[++i].getIntValue());
+        else if (args[i] == "--scaling")
+            scaling = true;
+        else
+            positional.add(args[i]);
+    }
+
+    if (positional.size() != 2)
+        return usage();
+
+    const juce::File corpus = juce::File::getCurrentWorkingDirectory().getChildFile(positional[0]);
+    const juce::File output = juce::File::getCurrentWorkingDirectory().getChildFile(positional[1]);
+    if (!corpus.isDirectory())
+    {
+        std::cerr << "Not a folder: " << corpus.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    const auto files = corpus.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi");
+    std::cout << "Found " << files.size() << " MIDI files in " << corpus.getFullPathName() << std::endl;
+    if (files.isEmpty())
+        return 1;
+
+    if (scaling)
+    {
+        juce::Array<int> counts;
+        for (int threads = 1; threads < numThreads; threads *= 2)
+            counts.add(threads);
+        counts.add(numThreads);
+
+        double baseline = 0.0;
+        for (int threads : counts)
+        {
+            auto run = countShards(files, threads);
+            report("  ", threads, run);
+            if (threads == 1)
+                baseline = run.seconds;
+            else
+                std::cout << "    speed-up " << juce::String(baseline / juce::jmax(run.seconds, 1.0e-9), 2) << "x" << std::endl;
+        }
+    }
+
+    auto run = countShards(files, numThreads);
+    report("Counted with ", numThreads, run);
+    if (run.filesFailed > 0)
+        std::cout << run.filesFailed << " file(s) could not be read" << std::endl;
+
+    const double mergeStart = juce::Time::getMillisecondCounterHiRes();
+    NGramBuilder merged;
+    for (const auto& shard : run.shards)
+        merged.merge(*shard);
+
+    if (!merged.write(output))
+    {
+        std::cerr << "Could not write " << output.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Merged " << run.shards.size() << " shard(s) and wrote " << merged.getNumEntries()
+              << " n-grams (" << merged.getNumTokens() << " tokens) to " << output.getFullPathName()
+              << " in " << juce::String((juce::Time::getMillisecondCounterHiRes() - mergeStart) * 0.001, 3)
+              << " s" << std::endl;
+    return 0;
+}